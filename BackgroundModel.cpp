@@ -0,0 +1,157 @@
+//
+// BackgroundModel.cpp - BackgroundModel class
+//
+// Website: http://batchloaf.wordpress.com
+//
+// The background mean is kept with 7 fractional bits so
+// that the difference between a new (shifted) grey level
+// and the mean always fits in a signed 16-bit value. This
+// lets the whole update run 8 pixels at a time in SSE2.
+//
+// The spread of each pixel is tracked sigma-delta style:
+// every frame the stored deviation moves one step (half a
+// grey level) towards the pixel's current absolute
+// difference from the mean, so it settles on the median of
+// that difference and fits in a byte. For Gaussian noise
+// the standard deviation is 1.48 times the median absolute
+// difference, which the foreground test uses as 47/32.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "BackgroundModel.h"
+#include "Platform.h"
+
+BackgroundModel::BackgroundModel()
+{
+	width = 0;
+	height = 0;
+	initialised = 0;
+	mean = NULL;
+	deviation = NULL;
+}
+
+BackgroundModel::~BackgroundModel()
+{
+	delete [] mean;
+	delete [] deviation;
+}
+
+int BackgroundModel::init(int w, int h, int rate_shift, int threshold_sd)
+{
+	delete [] mean;
+	delete [] deviation;
+	
+	width = w;
+	height = h;
+	shift = rate_shift;
+	threshold = threshold_sd;
+	initialised = 0;
+	mean = new unsigned short[w*h];
+	deviation = new unsigned char[w*h];
+	
+	return 0;
+}
+
+double BackgroundModel::process(unsigned char *pGrey, unsigned char *mask)
+{
+	int n, x, y, diff, d, dev;
+	int dev_min = 2 * BACKGROUND_MIN_DEVIATION;
+	int scale = 47 * threshold;	// limit = deviation * scale / 32
+	int dev_max = 32767 / scale;	// keeps the limit in a signed 16-bit value
+	int foreground = 0;
+	
+	if (dev_max > 255) dev_max = 255;
+	
+	// The first frame simply becomes the background
+	if (!initialised)
+	{
+		for (n=0 ; n<width*height ; ++n)
+		{
+			mean[n] = pGrey[n] << 7;
+			deviation[n] = (unsigned char)dev_min;
+		}
+		memset(mask, 0, width*height);
+		initialised = 1;
+		return 0.0;
+	}
+	
+	for (y=0 ; y<height ; ++y)
+	{
+		n = y*width;
+		x = 0;
+		
+#ifdef USE_SSE2
+		__m128i zero = _mm_setzero_si128();
+		__m128i one = _mm_set1_epi16(1);
+		__m128i minus_one = _mm_set1_epi16(-1);
+		__m128i vmin = _mm_set1_epi16((short)dev_min);
+		__m128i vmax = _mm_set1_epi16((short)dev_max);
+		__m128i vmax_diff = _mm_set1_epi16(255);
+		__m128i vscale = _mm_set1_epi16((short)scale);
+		__m128i count = _mm_setzero_si128();
+		
+		for ( ; x+8<=width ; x+=8, n+=8)
+		{
+			__m128i g = _mm_unpacklo_epi8(
+				_mm_loadl_epi64((__m128i *)(pGrey + n)), zero);
+			__m128i m = _mm_loadu_si128((__m128i *)(mean + n));
+			__m128i dev = _mm_unpacklo_epi8(
+				_mm_loadl_epi64((__m128i *)(deviation + n)), zero);
+			
+			// Absolute difference from the background in half
+			// grey levels (at most 255)
+			__m128i dm = _mm_sub_epi16(_mm_slli_epi16(g, 7), m);
+			__m128i d = _mm_srai_epi16(dm, 6);
+			d = _mm_max_epi16(d, _mm_sub_epi16(zero, d));
+			d = _mm_min_epi16(d, vmax_diff);
+			
+			// Foreground test against the current deviation
+			__m128i limit = _mm_mullo_epi16(
+				_mm_min_epi16(_mm_max_epi16(dev, vmin), vmax), vscale);
+			__m128i fg = _mm_cmpgt_epi16(_mm_slli_epi16(d, 5), limit);
+			count = _mm_sub_epi16(count, fg);
+			_mm_storel_epi64((__m128i *)(mask + n), _mm_packs_epi16(fg, fg));
+			
+			// Running average update of the mean and one step
+			// of the deviation towards the difference
+			m = _mm_add_epi16(m, _mm_srai_epi16(dm, shift));
+			dev = _mm_add_epi16(dev, _mm_min_epi16(_mm_max_epi16(
+				_mm_sub_epi16(d, dev), minus_one), one));
+			_mm_storeu_si128((__m128i *)(mean + n), m);
+			_mm_storel_epi64((__m128i *)(deviation + n), _mm_packus_epi16(dev, dev));
+		}
+		
+		count = _mm_add_epi16(count, _mm_srli_si128(count, 8));
+		count = _mm_add_epi16(count, _mm_srli_si128(count, 4));
+		count = _mm_add_epi16(count, _mm_srli_si128(count, 2));
+		foreground += _mm_extract_epi16(count, 0);
+#endif
+		
+		// Scalar version of the same update for the remaining pixels
+		for ( ; x<width ; ++x, ++n)
+		{
+			diff = (pGrey[n] << 7) - mean[n];
+			d = diff >> 6;
+			if (d < 0) d = -d;
+			if (d > 255) d = 255;
+			
+			dev = deviation[n];
+			if (dev < dev_min) dev = dev_min;
+			if (dev > dev_max) dev = dev_max;
+			if (32 * d > dev * scale)
+			{
+				mask[n] = 255;
+				foreground++;
+			}
+			else mask[n] = 0;
+			
+			mean[n] = (unsigned short)(mean[n] + (diff >> shift));
+			if (d > deviation[n]) deviation[n]++;
+			else if (d < deviation[n]) deviation[n]--;
+		}
+	}
+	
+	return (double)foreground / (width * height);
+}
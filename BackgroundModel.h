@@ -0,0 +1,52 @@
+//
+// BackgroundModel.h - BackgroundModel header file
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef BACKGROUNDMODEL_H
+#define BACKGROUNDMODEL_H
+
+// Default background learning rate is 1/2^5 = 1/32 per frame
+#define BACKGROUND_RATE_SHIFT 5
+
+// Default foreground threshold in standard deviations
+#define BACKGROUND_THRESHOLD 3
+
+// Smallest standard deviation (in grey levels) used for the
+// foreground test, so that sensor noise in very flat regions
+// is not detected
+#define BACKGROUND_MIN_DEVIATION 6
+
+// Exponentially weighted running average background model
+// with a per-pixel estimate of the spread of the grey level.
+// The mean is stored as a 16-bit fixed point value and the
+// spread as an 8-bit value, so the model uses three bytes
+// per pixel.
+class BackgroundModel
+{
+public:
+	BackgroundModel();
+	~BackgroundModel();
+	
+	// Allocate the model for w x h grey images. The learning
+	// rate is 1/2^rate_shift and pixels further than threshold
+	// standard deviations from the background are foreground.
+	int init(int w, int h, int rate_shift, int threshold);
+	
+	// Classify a top-down grey image against the background
+	// (writing 255 for foreground and 0 for background into
+	// mask) and then update the background with it. Returns
+	// the fraction of pixels that were foreground.
+	double process(unsigned char *pGrey, unsigned char *mask);
+	
+private:
+	int width, height;
+	int shift;	// learning rate is 1/2^shift
+	int threshold;	// threshold in standard deviations
+	int initialised;	// set once the first frame has been seen
+	unsigned short *mean;	// background grey level with 7 fractional bits
+	unsigned char *deviation;	// median absolute difference from the mean in half grey levels
+};
+
+#endif // BACKGROUNDMODEL_H
@@ -0,0 +1,98 @@
+//
+// CaptureScheduler.cpp - CaptureScheduler class
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Times are compared by the sign of their difference rather
+// than directly, so that the schedule keeps working when the
+// millisecond clock wraps around (every 49.7 days).
+//
+
+#include "CaptureScheduler.h"
+
+CaptureScheduler::CaptureScheduler()
+{
+	number_sources = 0;
+	start_time = 0;
+}
+
+int CaptureScheduler::addSource(int delay, int period)
+{
+	if (number_sources >= MAX_SCHEDULED_SOURCES) return -1;
+	
+	ScheduledSource *s = &sources[number_sources];
+	s->delay = delay;
+	s->period = period;
+	s->last_time = 0;
+	s->finished = 0;
+	return number_sources++;
+}
+
+int CaptureScheduler::numSources()
+{
+	return number_sources;
+}
+
+void CaptureScheduler::start(unsigned int time)
+{
+	start_time = time;
+	for (int n=0 ; n<number_sources ; ++n) sources[n].last_time = time;
+}
+
+unsigned int CaptureScheduler::nextTime(int source)
+{
+	ScheduledSource *s = &sources[source];
+	unsigned int next_time = s->last_time + s->period;
+	unsigned int first_time = start_time + s->delay;
+	
+	if ((int)(next_time - first_time) < 0) next_time = first_time;
+	return next_time;
+}
+
+int CaptureScheduler::due(unsigned int now)
+{
+	for (int n=0 ; n<number_sources ; ++n)
+	{
+		if (sources[n].finished) continue;
+		if ((int)(now - nextTime(n)) >= 0)
+		{
+			sources[n].last_time = now;
+			return n;
+		}
+	}
+	return -1;
+}
+
+unsigned int CaptureScheduler::waitTime(unsigned int now, unsigned int max_wait)
+{
+	unsigned int wait_time = max_wait;
+	
+	for (int n=0 ; n<number_sources ; ++n)
+	{
+		if (sources[n].finished) continue;
+		int remaining = (int)(nextTime(n) - now);
+		if (remaining <= 0) return 0;
+		if ((unsigned int)remaining < wait_time) wait_time = remaining;
+	}
+	return wait_time;
+}
+
+void CaptureScheduler::finish(int source)
+{
+	sources[source].finished = 1;
+}
+
+int CaptureScheduler::isFinished(int source)
+{
+	return sources[source].finished;
+}
+
+int CaptureScheduler::running()
+{
+	int count = 0;
+	for (int n=0 ; n<number_sources ; ++n)
+	{
+		if (!sources[n].finished) count++;
+	}
+	return count;
+}
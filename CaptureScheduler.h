@@ -0,0 +1,64 @@
+//
+// CaptureScheduler.h - CaptureScheduler header file
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef CAPTURESCHEDULER_H
+#define CAPTURESCHEDULER_H
+
+#define MAX_SCHEDULED_SOURCES 8
+
+// Capture timing of one source (camera)
+struct ScheduledSource
+{
+	int delay;	// time from start to the first capture (ms)
+	int period;	// minimum time between captures (ms)
+	unsigned int last_time;	// time the last capture was requested
+	int finished;
+};
+
+// Decides when to request a capture from each of several
+// sources. A source's next capture is due at its last capture
+// time plus its period, but not before its delay has elapsed
+// since start. Times are in milliseconds from a free-running
+// 32-bit clock (e.g. GetTickCount) and may wrap around.
+class CaptureScheduler
+{
+public:
+	CaptureScheduler();
+	
+	// Add a source and return its number (or -1 if there
+	// are already MAX_SCHEDULED_SOURCES)
+	int addSource(int delay, int period);
+	int numSources();
+	
+	// Start timing every source from the given time
+	void start(unsigned int time);
+	
+	// Time at which the source's next capture is due
+	unsigned int nextTime(int source);
+	
+	// If a capture is due at time now, record it and return
+	// the source, otherwise return -1. Call repeatedly until
+	// it returns -1 to find every source that is due.
+	int due(unsigned int now);
+	
+	// Time from now until the next capture of any source is
+	// due, limited to max_wait
+	unsigned int waitTime(unsigned int now, unsigned int max_wait);
+	
+	// Stop scheduling captures for a source
+	void finish(int source);
+	int isFinished(int source);
+	
+	// Number of sources not yet finished
+	int running();
+
+private:
+	ScheduledSource sources[MAX_SCHEDULED_SOURCES];
+	int number_sources;
+	unsigned int start_time;
+};
+
+#endif // CAPTURESCHEDULER_H
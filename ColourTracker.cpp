@@ -0,0 +1,153 @@
+//
+// ColourTracker.cpp - ColourTracker class
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Each pixel is classified with a single lookup in a
+// table indexed by its quantised BGR value. Every byte
+// of the table holds one bit per colour class, so all
+// classes are tracked in the same pass over the frame.
+//
+
+#include <string.h>
+
+#include "ColourTracker.h"
+
+ColourTracker::ColourTracker()
+{
+	memset(lut, 0, sizeof(lut));
+	num_targets = 0;
+}
+
+//
+// Convert an 8-bit RGB colour to HSV with hue in
+// degrees (0-360) and saturation and value in 0-255
+//
+static void rgb_to_hsv(int r, int g, int b, int *h, int *s, int *v)
+{
+	int max = r, min = r;
+	if (g > max) max = g;
+	if (b > max) max = b;
+	if (g < min) min = g;
+	if (b < min) min = b;
+	
+	*v = max;
+	*s = (max == 0) ? 0 : (255 * (max - min)) / max;
+	
+	if (max == min) *h = 0;
+	else if (max == r) *h = (360 + (60 * (g - b)) / (max - min)) % 360;
+	else if (max == g) *h = 120 + (60 * (b - r)) / (max - min);
+	else *h = 240 + (60 * (r - g)) / (max - min);
+}
+
+//
+// Add a new colour class. Every cell of the lookup table
+// whose centre colour falls inside the HSV range gets
+// the bit for the new class set.
+//
+int ColourTracker::addTarget(int hmin, int hmax, int smin, int smax, int vmin, int vmax)
+{
+	int b, g, r, h, s, v, in_range;
+	int shift = 8 - COLOUR_LUT_BITS;
+	int cells = 1 << COLOUR_LUT_BITS;
+	int half = 1 << (shift - 1);
+	
+	if (num_targets >= MAX_COLOUR_CLASSES) return -1;
+	
+	for (b=0 ; b<cells ; ++b)
+	{
+		for (g=0 ; g<cells ; ++g)
+		{
+			for (r=0 ; r<cells ; ++r)
+			{
+				rgb_to_hsv((r << shift) + half, (g << shift) + half,
+					(b << shift) + half, &h, &s, &v);
+				
+				// Hue range wraps around through 0 if hmin > hmax
+				if (hmin <= hmax) in_range = (h >= hmin && h <= hmax);
+				else in_range = (h >= hmin || h <= hmax);
+				
+				if (in_range && s >= smin && s <= smax && v >= vmin && v <= vmax)
+				{
+					lut[(b << (2*COLOUR_LUT_BITS)) | (g << COLOUR_LUT_BITS) | r]
+						|= (1 << num_targets);
+				}
+			}
+		}
+	}
+	
+	return num_targets++;
+}
+
+int ColourTracker::numTargets()
+{
+	return num_targets;
+}
+
+//
+// Classify each pixel with one table lookup and reduce
+// the class masks straight into area and centroid, so
+// no mask images are ever written to memory
+//
+void ColourTracker::process(unsigned char *pBuf, int w, int h, ColourTarget *results)
+{
+	int x, y, c, bits;
+	int shift = 8 - COLOUR_LUT_BITS;
+	int row_count[MAX_COLOUR_CLASSES];
+	int row_sum_x[MAX_COLOUR_CLASSES];
+	long long area[MAX_COLOUR_CLASSES];
+	long long sum_x[MAX_COLOUR_CLASSES];
+	long long sum_y[MAX_COLOUR_CLASSES];
+	unsigned char *p;
+	
+	for (c=0 ; c<num_targets ; ++c) area[c] = sum_x[c] = sum_y[c] = 0;
+	
+	// The frame is stored bottom-up, so buffer row n is
+	// image row h-1-n
+	for (y=0 ; y<h ; ++y)
+	{
+		p = pBuf + 3*(h-1-y)*w;
+		for (c=0 ; c<num_targets ; ++c) row_count[c] = row_sum_x[c] = 0;
+		
+		for (x=0 ; x<w ; ++x, p+=3)
+		{
+			bits = lut[((p[0] >> shift) << (2*COLOUR_LUT_BITS)) |
+						((p[1] >> shift) << COLOUR_LUT_BITS) |
+						(p[2] >> shift)];
+			
+			// Most pixels belong to no class at all
+			if (bits == 0) continue;
+			
+			for (c=0 ; bits ; ++c, bits >>= 1)
+			{
+				if (bits & 1)
+				{
+					row_count[c]++;
+					row_sum_x[c] += x;
+				}
+			}
+		}
+		
+		for (c=0 ; c<num_targets ; ++c)
+		{
+			area[c] += row_count[c];
+			sum_x[c] += row_sum_x[c];
+			sum_y[c] += (long long)row_count[c] * y;
+		}
+	}
+	
+	for (c=0 ; c<num_targets ; ++c)
+	{
+		results[c].area = (int)area[c];
+		if (area[c] > 0)
+		{
+			results[c].x = (double)sum_x[c] / area[c];
+			results[c].y = (double)sum_y[c] / area[c];
+		}
+		else
+		{
+			results[c].x = -1;
+			results[c].y = -1;
+		}
+	}
+}
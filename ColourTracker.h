@@ -0,0 +1,50 @@
+//
+// ColourTracker.h - ColourTracker header file
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef COLOURTRACKER_H
+#define COLOURTRACKER_H
+
+// Maximum number of colour classes (one bit each in the lookup table)
+#define MAX_COLOUR_CLASSES 8
+
+// Number of bits of each colour component used to index
+// the lookup table. With 5 bits per component the table
+// is 32x32x32 bytes, which fits comfortably in L1/L2 cache.
+#define COLOUR_LUT_BITS 5
+#define COLOUR_LUT_SIZE (1 << (3*COLOUR_LUT_BITS))
+
+// Result for one colour class in one frame
+struct ColourTarget
+{
+	int area;	// number of matching pixels
+	double x;	// centroid x coordinate (-1 if area is zero)
+	double y;	// centroid y coordinate, top row is zero (-1 if area is zero)
+};
+
+// Tracks the centroid and area of up to MAX_COLOUR_CLASSES
+// colour ranges in a single pass over a 24-bit BGR frame
+class ColourTracker
+{
+public:
+	ColourTracker();
+	
+	// Add a colour class specified as an HSV range. Hue is in
+	// degrees (0-360, wrapping around if hmin > hmax), saturation
+	// and value are 0-255. Returns the class number, or -1 if
+	// no more classes can be added.
+	int addTarget(int hmin, int hmax, int smin, int smax, int vmin, int vmax);
+	int numTargets();
+	
+	// Classify every pixel of a bottom-up BGR24 frame and
+	// fill in one ColourTarget per class in results
+	void process(unsigned char *pBuf, int w, int h, ColourTarget *results);
+	
+private:
+	unsigned char lut[COLOUR_LUT_SIZE]; // class bits for each quantised BGR colour
+	int num_targets;
+};
+
+#endif // COLOURTRACKER_H
@@ -0,0 +1,653 @@
+//
+// FeatureTracker.cpp - FeatureTracker class
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Corners are found with the FAST-9 test (Rosten and
+// Drummond) and tracked with the pyramidal implementation
+// of the Lucas-Kanade tracker described by Bouguet.
+// New corners are only added in cells of a coarse grid
+// that do not already hold a feature, which keeps the
+// features spread evenly across the image.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "FeatureTracker.h"
+#include "Platform.h"
+
+// Offsets of the 16 pixels on the FAST circle of radius 3
+static const int circle_x[16] = {0, 1, 2, 3, 3, 3, 2, 1, 0, -1, -2, -3, -3, -3, -2, -1};
+static const int circle_y[16] = {-3, -3, -2, -1, 0, 1, 2, 3, 3, 3, 2, 1, 0, -1, -2, -3};
+
+FeatureTracker::FeatureTracker()
+{
+	width = 0;
+	height = 0;
+	for (int n=0 ; n<LK_LEVELS ; ++n) grad_x[n] = grad_y[n] = NULL;
+	feature_list = NULL;
+	occupied = NULL;
+	retry = NULL;
+	window_t = window_dx = window_dy = window_j = NULL;
+}
+
+FeatureTracker::~FeatureTracker()
+{
+	for (int n=0 ; n<LK_LEVELS ; ++n)
+	{
+		delete [] grad_x[n];
+		delete [] grad_y[n];
+	}
+	delete [] feature_list;
+	delete [] occupied;
+	delete [] retry;
+	delete [] window_t;
+	delete [] window_dx;
+	delete [] window_dy;
+	delete [] window_j;
+}
+
+int FeatureTracker::init(int w, int h, int maximum_features)
+{
+	int window_size = (2*LK_WINDOW+1) * (2*LK_WINDOW+1);
+	
+	width = w;
+	height = h;
+	max_features = maximum_features;
+	next_id = 1;
+	current = 0;
+	have_previous = 0;
+	num_features = 0;
+	
+	if (pyramids[0].init(w, h, LK_LEVELS) != 0) return 1;
+	if (pyramids[1].init(w, h, LK_LEVELS) != 0) return 1;
+	for (int n=0 ; n<LK_LEVELS ; ++n)
+	{
+		int size = pyramids[0].levelWidth(n) * pyramids[0].levelHeight(n);
+		grad_x[n] = new short[size];
+		grad_y[n] = new short[size];
+		memset(grad_x[n], 0, size * sizeof(short));
+		memset(grad_y[n], 0, size * sizeof(short));
+	}
+	
+	feature_list = new Feature[max_features];
+	
+	// Roughly one grid cell per feature
+	grid_size = (int)sqrt((double)w*h / max_features);
+	if (grid_size < 4) grid_size = 4;
+	grid_width = (w + grid_size - 1) / grid_size;
+	grid_height = (h + grid_size - 1) / grid_size;
+	occupied = new unsigned char[grid_width * grid_height];
+	retry = new unsigned char[grid_width * grid_height];
+	memset(retry, 0, grid_width * grid_height);
+	next_cell = 0;
+	
+	window_t = new float[window_size];
+	window_dx = new float[window_size];
+	window_dy = new float[window_size];
+	window_j = new float[window_size];
+	
+	return 0;
+}
+
+Feature *FeatureTracker::features()
+{
+	return feature_list;
+}
+
+int FeatureTracker::numFeatures()
+{
+	return num_features;
+}
+
+int FeatureTracker::process(unsigned char *pGrey)
+{
+	int n, m;
+	float x, y;
+	
+	pyramids[current].build(pGrey);
+	
+	// Track every feature from the previous frame, keeping
+	// only the ones which were found again
+	if (have_previous)
+	{
+		for (n=0, m=0 ; n<num_features ; ++n)
+		{
+			if (track(feature_list[n].x, feature_list[n].y, &x, &y))
+			{
+				feature_list[m].id = feature_list[n].id;
+				feature_list[m].x = x;
+				feature_list[m].y = y;
+				m++;
+			}
+		}
+		num_features = m;
+	}
+	
+	// Top up with new corners
+	if (num_features < max_features) detect(pGrey);
+	
+	// The current frame becomes the previous frame
+	computeGradients();
+	current = 1 - current;
+	have_previous = 1;
+	
+	return num_features;
+}
+
+//
+// Central difference gradients of every level of the
+// current pyramid (which will be the previous one when
+// the next frame is tracked)
+//
+void FeatureTracker::computeGradients()
+{
+	for (int level=0 ; level<LK_LEVELS ; ++level)
+	{
+		unsigned char *img = pyramids[current].level(level);
+		int w = pyramids[current].levelWidth(level);
+		int h = pyramids[current].levelHeight(level);
+		
+		for (int y=1 ; y<h-1 ; ++y)
+		{
+			unsigned char *p = img + y*w;
+			short *gx = grad_x[level] + y*w;
+			short *gy = grad_y[level] + y*w;
+			int x = 1;
+			
+#ifdef USE_SSE2
+			__m128i zero = _mm_setzero_si128();
+			for ( ; x+8<=w-1 ; x+=8)
+			{
+				__m128i l = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(p + x - 1)), zero);
+				__m128i r = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(p + x + 1)), zero);
+				__m128i u = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(p + x - w)), zero);
+				__m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(p + x + w)), zero);
+				_mm_storeu_si128((__m128i *)(gx + x), _mm_sub_epi16(r, l));
+				_mm_storeu_si128((__m128i *)(gy + x), _mm_sub_epi16(d, u));
+			}
+#endif
+			
+			for ( ; x<w-1 ; ++x)
+			{
+				gx[x] = (short)(p[x+1] - p[x-1]);
+				gy[x] = (short)(p[x+w] - p[x-w]);
+			}
+		}
+	}
+}
+
+#ifdef USE_SSE2
+//
+// Load 4 consecutive pixels or gradients as floats. The
+// pixels are copied with memcpy, since p need not be aligned.
+//
+static inline __m128 load4(unsigned char *p)
+{
+	int v;
+	memcpy(&v, p, 4);
+	__m128i zero = _mm_setzero_si128();
+	return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero), zero));
+}
+
+static inline __m128 load4(short *p)
+{
+	__m128i v = _mm_loadl_epi64((__m128i *)p);
+	return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), v), 16));
+}
+#endif
+
+//
+// Bilinear samples of count (at least 4) consecutive pixels
+// starting at p, with the same weights for every pixel. The
+// last group of 4 overlaps the one before it if count is not
+// a multiple of 4, so nothing beyond the last pixel is read.
+//
+static void sample_row(unsigned char *p, int w, int count,
+	float w00, float w01, float w10, float w11, float *out)
+{
+#ifdef USE_SSE2
+	__m128 v00 = _mm_set1_ps(w00), v01 = _mm_set1_ps(w01);
+	__m128 v10 = _mm_set1_ps(w10), v11 = _mm_set1_ps(w11);
+	for (int i=0 ; i<count ; i+=4)
+	{
+		int k = (i+4 <= count) ? i : count - 4;
+		__m128 s = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(v00, load4(p + k)), _mm_mul_ps(v01, load4(p + k + 1))),
+			_mm_add_ps(_mm_mul_ps(v10, load4(p + k + w)), _mm_mul_ps(v11, load4(p + k + w + 1))));
+		_mm_storeu_ps(out + k, s);
+	}
+#else
+	for (int i=0 ; i<count ; ++i)
+	{
+		out[i] = w00*p[i] + w01*p[i+1] + w10*p[i+w] + w11*p[i+w+1];
+	}
+#endif
+}
+
+// The same for a row of gradients
+static void sample_row(short *p, int w, int count,
+	float w00, float w01, float w10, float w11, float *out)
+{
+#ifdef USE_SSE2
+	__m128 v00 = _mm_set1_ps(w00), v01 = _mm_set1_ps(w01);
+	__m128 v10 = _mm_set1_ps(w10), v11 = _mm_set1_ps(w11);
+	for (int i=0 ; i<count ; i+=4)
+	{
+		int k = (i+4 <= count) ? i : count - 4;
+		__m128 s = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(v00, load4(p + k)), _mm_mul_ps(v01, load4(p + k + 1))),
+			_mm_add_ps(_mm_mul_ps(v10, load4(p + k + w)), _mm_mul_ps(v11, load4(p + k + w + 1))));
+		_mm_storeu_ps(out + k, s);
+	}
+#else
+	for (int i=0 ; i<count ; ++i)
+	{
+		out[i] = w00*p[i] + w01*p[i+1] + w10*p[i+w] + w11*p[i+w+1];
+	}
+#endif
+}
+
+#ifdef USE_SSE2
+static inline float sum_ps(__m128 v)
+{
+	v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+	return _mm_cvtss_f32(v);
+}
+#endif
+
+//
+// Accumulate the 2x2 gradient matrix over n window samples
+//
+static void gradient_matrix(float *dx, float *dy, int n,
+	float *Gxx, float *Gxy, float *Gyy)
+{
+	float xx = 0, xy = 0, yy = 0;
+	int k = 0;
+	
+#ifdef USE_SSE2
+	__m128 sxx = _mm_setzero_ps(), sxy = _mm_setzero_ps(), syy = _mm_setzero_ps();
+	for ( ; k+4<=n ; k+=4)
+	{
+		__m128 a = _mm_loadu_ps(dx + k);
+		__m128 b = _mm_loadu_ps(dy + k);
+		sxx = _mm_add_ps(sxx, _mm_mul_ps(a, a));
+		sxy = _mm_add_ps(sxy, _mm_mul_ps(a, b));
+		syy = _mm_add_ps(syy, _mm_mul_ps(b, b));
+	}
+	xx = sum_ps(sxx);
+	xy = sum_ps(sxy);
+	yy = sum_ps(syy);
+#endif
+	
+	for ( ; k<n ; ++k)
+	{
+		xx += dx[k] * dx[k];
+		xy += dx[k] * dy[k];
+		yy += dy[k] * dy[k];
+	}
+	*Gxx = xx;
+	*Gxy = xy;
+	*Gyy = yy;
+}
+
+//
+// Accumulate the mismatch vector and the absolute error
+// between the template t and the samples j over n samples
+//
+static void mismatch(float *t, float *j, float *dx, float *dy, int n,
+	float *bx, float *by, float *error)
+{
+	float sx = 0, sy = 0, se = 0;
+	int k = 0;
+	
+#ifdef USE_SSE2
+	__m128 vx = _mm_setzero_ps(), vy = _mm_setzero_ps(), ve = _mm_setzero_ps();
+	__m128 sign = _mm_set1_ps(-0.0f);
+	for ( ; k+4<=n ; k+=4)
+	{
+		__m128 e = _mm_sub_ps(_mm_loadu_ps(t + k), _mm_loadu_ps(j + k));
+		vx = _mm_add_ps(vx, _mm_mul_ps(e, _mm_loadu_ps(dx + k)));
+		vy = _mm_add_ps(vy, _mm_mul_ps(e, _mm_loadu_ps(dy + k)));
+		ve = _mm_add_ps(ve, _mm_andnot_ps(sign, e));
+	}
+	sx = sum_ps(vx);
+	sy = sum_ps(vy);
+	se = sum_ps(ve);
+#endif
+	
+	for ( ; k<n ; ++k)
+	{
+		float e = t[k] - j[k];
+		sx += e * dx[k];
+		sy += e * dy[k];
+		se += fabsf(e);
+	}
+	*bx = sx;
+	*by = sy;
+	*error = se;
+}
+
+//
+// Track one feature from the previous frame into the current
+// frame, working from the top of the pyramid down. Returns 0
+// if the feature was lost.
+//
+int FeatureTracker::track(float x, float y, float *new_x, float *new_y)
+{
+	int R = LK_WINDOW;
+	int S = 2*R+1;	// window size
+	int N = S * S;
+	float gx = 0, gy = 0;	// motion guess carried down the pyramid
+	float dx = 0, dy = 0;	// motion found at the current level
+	float error = 0;
+	
+	for (int level=LK_LEVELS-1 ; level>=0 ; --level)
+	{
+		unsigned char *I = pyramids[1-current].level(level);
+		unsigned char *J = pyramids[current].level(level);
+		short *Ix = grad_x[level];
+		short *Iy = grad_y[level];
+		int w = pyramids[current].levelWidth(level);
+		int h = pyramids[current].levelHeight(level);
+		float scale = 1.0f / (1 << level);
+		float px = x * scale, py = y * scale;
+		int j, k, n, ix, iy, iteration;
+		
+		if (level < LK_LEVELS-1)
+		{
+			gx = 2 * (gx + dx);
+			gy = 2 * (gy + dy);
+		}
+		dx = dy = 0;
+		
+		// Skip coarse levels where the window does not fit
+		ix = (int)px;
+		iy = (int)py;
+		if (ix-R < 1 || iy-R < 1 || ix+R+1 >= w-1 || iy+R+1 >= h-1)
+		{
+			if (level == 0) return 0;
+			continue;
+		}
+		
+		// Sample the template and its gradients around the
+		// feature (the bilinear weights are the same for
+		// every pixel of the window, so each row of the
+		// window is sampled 4 pixels at a time with SSE2)
+		float ax = px - ix, ay = py - iy;
+		float w00 = (1-ax)*(1-ay), w01 = ax*(1-ay), w10 = (1-ax)*ay, w11 = ax*ay;
+		float Gxx, Gxy, Gyy;
+		
+		for (j=-R, k=0 ; j<=R ; ++j, k+=S)
+		{
+			n = (iy+j)*w + ix - R;
+			sample_row(I + n, w, S, w00, w01, w10, w11, window_t + k);
+			sample_row(Ix + n, w, S, 0.5f*w00, 0.5f*w01, 0.5f*w10, 0.5f*w11, window_dx + k);
+			sample_row(Iy + n, w, S, 0.5f*w00, 0.5f*w01, 0.5f*w10, 0.5f*w11, window_dy + k);
+		}
+		gradient_matrix(window_dx, window_dy, N, &Gxx, &Gxy, &Gyy);
+		
+		float det = Gxx*Gyy - Gxy*Gxy;
+		float min_eigenvalue = (Gxx + Gyy - sqrtf((Gxx-Gyy)*(Gxx-Gyy) + 4*Gxy*Gxy)) / (2*N);
+		if (det < 1e-6f || min_eigenvalue < LK_MIN_EIGENVALUE)
+		{
+			if (level == 0) return 0;
+			continue;
+		}
+		
+		// Gauss-Newton iterations on the displacement
+		for (iteration=0 ; iteration<LK_ITERATIONS ; ++iteration)
+		{
+			float qx = px + gx + dx, qy = py + gy + dy;
+			int jx = (int)floorf(qx), jy = (int)floorf(qy);
+			if (jx-R < 0 || jy-R < 0 || jx+R+1 >= w || jy+R+1 >= h)
+			{
+				if (level == 0) return 0;
+				break;
+			}
+			
+			float bx_ = qx - jx, by_ = qy - jy;
+			float v00 = (1-bx_)*(1-by_), v01 = bx_*(1-by_), v10 = (1-bx_)*by_, v11 = bx_*by_;
+			float bx, by;
+			
+			for (j=-R, k=0 ; j<=R ; ++j, k+=S)
+			{
+				n = (jy+j)*w + jx - R;
+				sample_row(J + n, w, S, v00, v01, v10, v11, window_j + k);
+			}
+			mismatch(window_t, window_j, window_dx, window_dy, N, &bx, &by, &error);
+			
+			float ddx = (Gyy*bx - Gxy*by) / det;
+			float ddy = (Gxx*by - Gxy*bx) / det;
+			dx += ddx;
+			dy += ddy;
+			if (ddx*ddx + ddy*ddy < LK_EPSILON*LK_EPSILON) break;
+		}
+	}
+	
+	if (error / N > LK_MAX_ERROR) return 0;
+	
+	*new_x = x + gx + dx;
+	*new_y = y + gy + dy;
+	if (*new_x < 0 || *new_y < 0 || *new_x > width-1 || *new_y > height-1) return 0;
+	
+	return 1;
+}
+
+//
+// FAST-9 test for a single pixel. Returns a corner score
+// (1-255), or 0 if the pixel is not a corner.
+//
+static int fast_score(unsigned char *p, int *offsets, int threshold)
+{
+	int c = p[0], v, k;
+	unsigned int bright = 0, dark = 0, run;
+	int bright_sum = 0, dark_sum = 0;
+	
+	for (k=0 ; k<16 ; ++k)
+	{
+		v = p[offsets[k]];
+		if (v > c + threshold)
+		{
+			bright |= 1 << k;
+			bright_sum += v - c - threshold;
+		}
+		else if (v < c - threshold)
+		{
+			dark |= 1 << k;
+			dark_sum += c - threshold - v;
+		}
+	}
+	
+	// Look for 9 contiguous pixels, allowing for wrap around
+	for (int pass=0 ; pass<2 ; ++pass)
+	{
+		unsigned int m = (pass == 0) ? bright : dark;
+		m |= m << 16;
+		run = m;
+		for (k=1 ; k<9 ; ++k) run &= m >> k;
+		if (run)
+		{
+			v = 1 + ((pass == 0) ? bright_sum : dark_sum) / 4;
+			return (v > 255) ? 255 : v;
+		}
+	}
+	
+	return 0;
+}
+
+#ifdef USE_SSE2
+//
+// Quick rejection test on the 16 pixels starting at p. An
+// arc of 9 pixels always contains two neighbouring compass
+// points (up, right, down, left), so pixels without two such
+// brighter or darker points cannot be corners. Returns a
+// mask with a bit set for each pixel which might be a corner.
+//
+static inline int fast_candidates(unsigned char *p, int width)
+{
+	__m128i t = _mm_set1_epi8((char)FAST_THRESHOLD);
+	__m128i zero = _mm_setzero_si128();
+	__m128i c = _mm_loadu_si128((__m128i *)p);
+	__m128i hi = _mm_adds_epu8(c, t);
+	__m128i lo = _mm_subs_epu8(c, t);
+	__m128i p0 = _mm_loadu_si128((__m128i *)(p - 3*width));
+	__m128i p1 = _mm_loadu_si128((__m128i *)(p + 3));
+	__m128i p2 = _mm_loadu_si128((__m128i *)(p + 3*width));
+	__m128i p3 = _mm_loadu_si128((__m128i *)(p - 3));
+	
+	// All ones where a compass point is not brighter / darker
+	__m128i b0 = _mm_cmpeq_epi8(_mm_subs_epu8(p0, hi), zero);
+	__m128i b1 = _mm_cmpeq_epi8(_mm_subs_epu8(p1, hi), zero);
+	__m128i b2 = _mm_cmpeq_epi8(_mm_subs_epu8(p2, hi), zero);
+	__m128i b3 = _mm_cmpeq_epi8(_mm_subs_epu8(p3, hi), zero);
+	__m128i d0 = _mm_cmpeq_epi8(_mm_subs_epu8(lo, p0), zero);
+	__m128i d1 = _mm_cmpeq_epi8(_mm_subs_epu8(lo, p1), zero);
+	__m128i d2 = _mm_cmpeq_epi8(_mm_subs_epu8(lo, p2), zero);
+	__m128i d3 = _mm_cmpeq_epi8(_mm_subs_epu8(lo, p3), zero);
+	
+	__m128i not_bright = _mm_and_si128(
+		_mm_and_si128(_mm_or_si128(b0, b1), _mm_or_si128(b1, b2)),
+		_mm_and_si128(_mm_or_si128(b2, b3), _mm_or_si128(b3, b0)));
+	__m128i not_dark = _mm_and_si128(
+		_mm_and_si128(_mm_or_si128(d0, d1), _mm_or_si128(d1, d2)),
+		_mm_and_si128(_mm_or_si128(d2, d3), _mm_or_si128(d3, d0)));
+	return ~_mm_movemask_epi8(_mm_and_si128(not_bright, not_dark)) & 0xffff;
+}
+#endif
+
+//
+// Find the strongest FAST corner in the rectangle from
+// (x0,y0) to (x1,y1) (exclusive). Returns its score and sets
+// best to its pixel index, or returns 0 if there is none.
+//
+int FeatureTracker::bestCorner(unsigned char *pGrey, int *offsets,
+	int x0, int y0, int x1, int y1, int *best)
+{
+	int x, y, n, s, best_score = 0;
+	
+	for (y=y0 ; y<y1 ; ++y)
+	{
+		x = x0;
+		
+#ifdef USE_SSE2
+		// 16 pixels at a time, the last group overlapping the
+		// one before it, with the pixels already tested masked
+		while (x1 - x0 >= 16 && x < x1)
+		{
+			int start = (x + 16 <= x1) ? x : x1 - 16;
+			int mask = fast_candidates(pGrey + y*width + start, width);
+			mask &= 0xffff << (x - start);
+			
+			while (mask)
+			{
+				int k = 0;
+				while (!(mask & (1 << k))) ++k;
+				mask &= ~(1 << k);
+				
+				n = y*width + start + k;
+				s = fast_score(pGrey + n, offsets, FAST_THRESHOLD);
+				if (s > best_score)
+				{
+					best_score = s;
+					*best = n;
+				}
+			}
+			x = start + 16;
+		}
+#endif
+		
+		for ( ; x<x1 ; ++x)
+		{
+			n = y*width + x;
+			s = fast_score(pGrey + n, offsets, FAST_THRESHOLD);
+			if (s > best_score)
+			{
+				best_score = s;
+				*best = n;
+			}
+		}
+	}
+	
+	return best_score;
+}
+
+//
+// Add the strongest FAST corner of grid cells without a
+// feature until there are max_features. The search carries on
+// each frame from the cell after the last one searched, so it
+// only costs as much as the number of features lost, and every
+// empty cell gets its turn. Cells without a corner are left
+// alone for FAST_RETRY_FRAMES.
+//
+void FeatureTracker::detect(unsigned char *pGrey)
+{
+	int x, y, n, k, s, c;
+	int number_cells = grid_width * grid_height;
+	int border = LK_WINDOW + 2;
+	int offsets[16];
+	
+	if (border < 3) border = 3;
+	for (k=0 ; k<16 ; ++k) offsets[k] = circle_y[k]*width + circle_x[k];
+	
+	// Mark grid cells which already hold a feature
+	memset(occupied, 0, number_cells);
+	for (n=0 ; n<num_features ; ++n)
+	{
+		occupied[((int)feature_list[n].y / grid_size) * grid_width +
+			(int)feature_list[n].x / grid_size] = 1;
+	}
+	
+	for (k=0 ; k<number_cells && num_features<max_features ; ++k)
+	{
+		c = next_cell;
+		if (++next_cell == number_cells) next_cell = 0;
+		
+		if (occupied[c]) continue;
+		if (retry[c] > 0)
+		{
+			retry[c]--;
+			continue;
+		}
+		
+		// The part of the cell where a corner can be tracked
+		x = c % grid_width;
+		y = c / grid_width;
+		int x0 = x*grid_size, y0 = y*grid_size;
+		int x1 = x0 + grid_size, y1 = y0 + grid_size;
+		if (x0 < border) x0 = border;
+		if (y0 < border) y0 = border;
+		if (x1 > width-border) x1 = width-border;
+		if (y1 > height-border) y1 = height-border;
+		if (x0 >= x1 || y0 >= y1) continue;
+		
+		s = bestCorner(pGrey, offsets, x0, y0, x1, y1, &n);
+		if (s == 0)
+		{
+			retry[c] = FAST_RETRY_FRAMES;
+			continue;
+		}
+		
+		// Leave corners which are stronger just across the
+		// cell's edge to the neighbouring cell, so the same
+		// corner isn't found twice
+		int stronger = 0;
+		for (int j=-1 ; j<=1 ; ++j)
+		{
+			for (int i=-1 ; i<=1 ; ++i)
+			{
+				if ((i || j) && fast_score(pGrey + n + j*width + i, offsets, FAST_THRESHOLD) > s)
+					stronger = 1;
+			}
+		}
+		if (stronger) continue;
+		
+		feature_list[num_features].id = next_id++;
+		feature_list[num_features].x = (float)(n % width);
+		feature_list[num_features].y = (float)(n / width);
+		num_features++;
+	}
+}
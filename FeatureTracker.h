@@ -0,0 +1,94 @@
+//
+// FeatureTracker.h - FeatureTracker header file
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef FEATURETRACKER_H
+#define FEATURETRACKER_H
+
+#include "ImagePyramid.h"
+
+// FAST corner detector threshold (grey levels)
+#define FAST_THRESHOLD 20
+
+// Empty grid cells in which no corner was found are not
+// searched again for this many frames
+#define FAST_RETRY_FRAMES 8
+
+// Number of pyramid levels used for Lucas-Kanade tracking
+#define LK_LEVELS 3
+
+// Lucas-Kanade window is (2*LK_WINDOW+1) pixels square (LK_WINDOW >= 2)
+#define LK_WINDOW 5
+
+// Lucas-Kanade iteration limit and convergence threshold (pixels)
+#define LK_ITERATIONS 10
+#define LK_EPSILON 0.03f
+
+// Features are dropped if the smallest eigenvalue of the
+// gradient matrix (per window pixel) falls below this value
+// or if the mean absolute error of the match exceeds LK_MAX_ERROR
+#define LK_MIN_EIGENVALUE 5.0f
+#define LK_MAX_ERROR 25.0f
+
+// One tracked feature. Coordinates are in pixels with the
+// centre of the image's top-left pixel at (0,0).
+struct Feature
+{
+	int id;
+	float x, y;
+};
+
+// Detects FAST corners and tracks them from frame to frame
+// with pyramidal Lucas-Kanade optical flow. All buffers are
+// allocated by init, so nothing is allocated per frame.
+class FeatureTracker
+{
+public:
+	FeatureTracker();
+	~FeatureTracker();
+	
+	// Allocate buffers for w x h grey images
+	int init(int w, int h, int maximum_features);
+	
+	// Track existing features into a new top-down grey
+	// image, then top up with newly detected corners.
+	// Returns the number of features now being tracked.
+	int process(unsigned char *pGrey);
+	
+	Feature *features();
+	int numFeatures();
+	
+private:
+	int width, height;
+	int max_features;
+	int next_id;	// id to give the next new feature
+	
+	ImagePyramid pyramids[2];	// previous and current frame
+	int current;	// index of the current frame's pyramid
+	int have_previous;	// set once a previous frame exists
+	short *grad_x[LK_LEVELS];	// gradients of the previous frame's pyramid
+	short *grad_y[LK_LEVELS];
+	
+	Feature *feature_list;
+	int num_features;
+	
+	int grid_size;	// features are spread out on a grid of this size
+	int grid_width, grid_height;
+	unsigned char *occupied;	// set for grid cells holding a feature
+	unsigned char *retry;	// frames until an empty cell is searched again
+	int next_cell;	// cell at which the next search for corners starts
+	
+	float *window_t;	// template and gradient samples for LK
+	float *window_dx;
+	float *window_dy;
+	float *window_j;	// samples of the current frame for LK
+	
+	void computeGradients();
+	int track(float x, float y, float *new_x, float *new_y);
+	void detect(unsigned char *pGrey);
+	int bestCorner(unsigned char *pGrey, int *offsets, int x0, int y0, int x1, int y1, int *best);
+};
+
+#endif // FEATURETRACKER_H
@@ -0,0 +1,373 @@
+//
+// FrameFanout.cpp - FrameFanout class
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Each sink's region is copied once from the frame's pyramid
+// into a buffer from the pool, and a pointer to that buffer
+// is put on the queue of every sink that is due a frame and
+// writes the same region. The buffer's reference count is
+// the number of sinks holding it, and the last sink to
+// finish with it returns it to the pool.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FrameFanout.h"
+#include "ImageUtils.h"
+
+FrameFanout::FrameFanout()
+{
+	width = height = 0;
+	frame_size = 0;
+	num_sinks = 0;
+	running = 0;
+	pool = NULL;
+	pool_size = 0;
+	free_frames = NULL;
+	num_free = 0;
+	pool_drops = 0;
+}
+
+FrameFanout::~FrameFanout()
+{
+	stop();
+	for (int n=0 ; n<num_sinks ; ++n) delete [] sinks[n].queue;
+	for (int n=0 ; n<pool_size ; ++n) delete [] pool[n].data;
+	delete [] pool;
+	delete [] free_frames;
+}
+
+int FrameFanout::addSink(char *pattern, double period, int queue_length,
+	int drop_policy, char *command, OutputRegion *region)
+{
+	if (running || num_sinks >= MAX_SINKS || queue_length < 1) return 1;
+	
+	// The pattern is used as a printf format, so it may only
+	// hold a single integer conversion
+	char *p = strchr(pattern, '%');
+	if (p)
+	{
+		for (++p ; *p >= '0' && *p <= '9' ; ++p);
+		if (*p != 'd' || strchr(p, '%')) return 1;
+	}
+	
+	FrameSink *s = &sinks[num_sinks++];
+	strncpy(s->pattern, pattern, SINK_STRING_LENGTH - 1);
+	s->pattern[SINK_STRING_LENGTH - 1] = '\0';
+	strncpy(s->command, command ? command : "", SINK_STRING_LENGTH - 1);
+	s->command[SINK_STRING_LENGTH - 1] = '\0';
+	s->period = period;
+	s->queue_length = queue_length;
+	s->drop_policy = drop_policy;
+	if (region) s->region = *region;
+	else memset(&s->region, 0, sizeof(OutputRegion));
+	s->fanout = this;
+	s->queue = new SharedFrame*[queue_length];
+	s->head = s->count = 0;
+	s->stopping = 0;
+	s->last_accepted = 0;
+	s->accepted = s->written = s->dropped = 0;
+	s->write_time = 0;
+	
+	return 0;
+}
+
+int FrameFanout::numSinks()
+{
+	return num_sinks;
+}
+
+int FrameFanout::start(int w, int h)
+{
+	int n;
+	
+	if (running || num_sinks == 0) return 1;
+	
+	width = w;
+	height = h;
+	
+	// Buffers are big enough for the largest sink region
+	frame_size = 0;
+	for (n=0 ; n<num_sinks ; ++n)
+	{
+		FrameSink *s = &sinks[n];
+		if (level_region(&s->region, w, h, &s->x, &s->y, &s->w, &s->h) != 0) return 1;
+		if (3 * s->w * s->h > frame_size) frame_size = 3 * s->w * s->h;
+	}
+	
+	// Each sink holds at most a full queue plus the frame it
+	// is writing, and one more buffer may be needed for each
+	// region being shared, so the pool can never run out
+	pool_size = 0;
+	for (n=0 ; n<num_sinks ; ++n) pool_size += sinks[n].queue_length + 2;
+	pool = new SharedFrame[pool_size];
+	free_frames = new SharedFrame*[pool_size];
+	for (n=0 ; n<pool_size ; ++n)
+	{
+		pool[n].data = new unsigned char[frame_size];
+		free_frames[n] = &pool[n];
+	}
+	num_free = pool_size;
+	
+	for (n=0 ; n<num_sinks ; ++n)
+	{
+		if (sinks[n].thread.start(sinkThread, &sinks[n]) != 0)
+		{
+			num_sinks = n;
+			stop();
+			return 1;
+		}
+	}
+	
+	running = 1;
+	return 0;
+}
+
+int FrameFanout::isDue(FrameSink *s, double time)
+{
+	// Rate limit each sink. Only the submitting thread changes
+	// accepted and last_accepted, so they are read unlocked here.
+	return s->accepted == 0 || time - s->last_accepted >= s->period;
+}
+
+int FrameFanout::levelsDue(double time)
+{
+	int levels = 0;
+	
+	if (!running) return 0;
+	
+	for (int n=0 ; n<num_sinks ; ++n)
+	{
+		if (isDue(&sinks[n], time) && sinks[n].region.level >= levels)
+			levels = sinks[n].region.level + 1;
+	}
+	return levels;
+}
+
+void FrameFanout::submit(ImagePyramid *pyramid, int frame_number, double time)
+{
+	SharedFrame *frames[MAX_SINKS];
+	int n, m;
+	
+	if (!running) return;
+	
+	// Copy the region of each sink that is due a frame,
+	// sharing the copy with later sinks with the same region
+	for (n=0 ; n<num_sinks ; ++n)
+	{
+		FrameSink *s = &sinks[n];
+		frames[n] = NULL;
+		if (!isDue(s, time)) continue;
+		
+		for (m=0 ; m<n ; ++m)
+		{
+			FrameSink *t = &sinks[m];
+			if (frames[m] && t->region.level == s->region.level &&
+				t->x == s->x && t->y == s->y && t->w == s->w && t->h == s->h) break;
+		}
+		if (m < n)
+		{
+			frames[n] = frames[m];
+			frames[n]->references++;
+			continue;
+		}
+		
+		frames[n] = acquire();
+		if (frames[n] == NULL)
+		{
+			pool_drops++;
+			continue;
+		}
+		
+		int level = s->region.level;
+		crop_frame(pyramid->level(level), pyramid->levelWidth(level),
+			pyramid->levelHeight(level), s->x, s->y, s->w, s->h, frames[n]->data);
+		frames[n]->number = frame_number;
+		frames[n]->time = time;
+		frames[n]->width = s->w;
+		frames[n]->height = s->h;
+		frames[n]->references = 1;
+	}
+	
+	// Queue the frames once all of their references are counted
+	for (n=0 ; n<num_sinks ; ++n)
+	{
+		if (frames[n] == NULL) continue;
+		enqueue(&sinks[n], frames[n]);
+	}
+}
+
+void FrameFanout::stop()
+{
+	for (int n=0 ; n<num_sinks ; ++n)
+	{
+		FrameSink *s = &sinks[n];
+		s->queue_lock.lock();
+		s->stopping = 1;
+		s->queue_lock.unlock();
+		s->frames_waiting.post();
+		s->thread.join();
+	}
+	running = 0;
+}
+
+void FrameFanout::printStats(char *label)
+{
+	for (int n=0 ; n<num_sinks ; ++n)
+	{
+		FrameSink *s = &sinks[n];
+		int accepted, written, dropped;
+		double write_time;
+		
+		s->queue_lock.lock();
+		accepted = s->accepted;
+		written = s->written;
+		dropped = s->dropped;
+		write_time = s->write_time;
+		s->queue_lock.unlock();
+		
+		fprintf(stderr, "%ssink %s (%dx%d): %d frames accepted, %d written, %d dropped",
+			label, s->pattern, s->w, s->h, accepted, written, dropped);
+		if (written > 0)
+		{
+			fprintf(stderr, ", %.2f ms/frame writing", write_time / written);
+		}
+		fprintf(stderr, "\n");
+	}
+	if (pool_drops > 0)
+	{
+		fprintf(stderr, "%ssinks missed %d frames (no free buffer)\n", label, pool_drops);
+	}
+}
+
+void FrameFanout::sinkCounts(int n, int *accepted, int *written, int *dropped)
+{
+	FrameSink *s = &sinks[n];
+	
+	s->queue_lock.lock();
+	*accepted = s->accepted;
+	*written = s->written;
+	*dropped = s->dropped;
+	s->queue_lock.unlock();
+}
+
+int FrameFanout::framesInUse()
+{
+	pool_lock.lock();
+	int in_use = pool_size - num_free;
+	pool_lock.unlock();
+	
+	return in_use;
+}
+
+SharedFrame *FrameFanout::acquire()
+{
+	SharedFrame *frame = NULL;
+	
+	pool_lock.lock();
+	if (num_free > 0) frame = free_frames[--num_free];
+	pool_lock.unlock();
+	
+	return frame;
+}
+
+void FrameFanout::release(SharedFrame *frame)
+{
+	if (atomic_decrement(&frame->references) != 0) return;
+	
+	pool_lock.lock();
+	free_frames[num_free++] = frame;
+	pool_lock.unlock();
+}
+
+//
+// Add a frame to a sink's queue, dropping a frame if the
+// queue is full. The semaphore is only posted when the
+// number of frames waiting goes up. The sink's counts are
+// all updated under its queue lock.
+//
+void FrameFanout::enqueue(FrameSink *s, SharedFrame *frame)
+{
+	SharedFrame *dropped_frame = NULL;
+	
+	s->queue_lock.lock();
+	s->last_accepted = frame->time;
+	s->accepted++;
+	if (s->count == s->queue_length)
+	{
+		s->dropped++;
+		if (s->drop_policy == SINK_DROP_NEWEST)
+		{
+			s->queue_lock.unlock();
+			release(frame);
+			return;
+		}
+		dropped_frame = s->queue[s->head];
+		s->head = (s->head + 1) % s->queue_length;
+		s->count--;
+	}
+	s->queue[(s->head + s->count) % s->queue_length] = frame;
+	s->count++;
+	s->queue_lock.unlock();
+	
+	if (dropped_frame) release(dropped_frame);
+	else s->frames_waiting.post();
+}
+
+//
+// Sink thread: write each frame from the queue to a file and
+// run the sink's command if it has one. When stopping, the
+// frames already queued are written before the thread exits.
+//
+void FrameFanout::sinkThread(void *sink)
+{
+	FrameSink *s = (FrameSink *)sink;
+	FrameFanout *fanout = s->fanout;
+	char filename[SINK_STRING_LENGTH + 20];
+	char command_line[2*SINK_STRING_LENGTH + 20];
+	
+	while(1)
+	{
+		s->frames_waiting.wait();
+		
+		s->queue_lock.lock();
+		if (s->count == 0)
+		{
+			int stopping = s->stopping;
+			s->queue_lock.unlock();
+			if (stopping) break;
+			continue;
+		}
+		SharedFrame *frame = s->queue[s->head];
+		s->head = (s->head + 1) % s->queue_length;
+		s->count--;
+		s->queue_lock.unlock();
+		
+		double start_time = get_time_ms();
+		sprintf(filename, s->pattern, frame->number);
+		int length = strlen(filename);
+		if (length > 4 && strcmp(filename + length - 4, ".bmp") == 0)
+		{
+			write_bmp_file(filename, frame->data, frame->width, frame->height);
+		}
+		else
+		{
+			write_pgm_file(filename, frame->data, frame->width, frame->height);
+		}
+		fanout->release(frame);
+		
+		if (s->command[0])
+		{
+			sprintf(command_line, "%s %s", s->command, filename);
+			system(command_line);
+		}
+		
+		s->queue_lock.lock();
+		s->write_time += get_time_ms() - start_time;
+		s->written++;
+		s->queue_lock.unlock();
+	}
+}
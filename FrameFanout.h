@@ -0,0 +1,124 @@
+//
+// FrameFanout.h - FrameFanout header file
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef FRAMEFANOUT_H
+#define FRAMEFANOUT_H
+
+#include "Platform.h"
+#include "ImagePyramid.h"
+
+#define MAX_SINKS 8
+#define SINK_STRING_LENGTH 200
+
+// Default number of frames a sink can have waiting
+#define SINK_QUEUE_LENGTH 4
+
+// What a sink does with a new frame when its queue is full
+#define SINK_DROP_OLDEST 1	// discard the oldest waiting frame
+#define SINK_DROP_NEWEST 2	// discard the new frame
+
+// A captured frame shared by any number of sinks. The
+// pixels are not changed while any sink holds the frame.
+struct SharedFrame
+{
+	volatile long references;	// number of sinks still using the frame
+	int number;	// frame number
+	double time;	// time the frame was received (ms)
+	int width, height;	// size of the sink's region
+	unsigned char *data;	// bottom-up BGR pixels
+};
+
+class FrameFanout;
+
+// One output of the fan-out, with its own thread and queue
+struct FrameSink
+{
+	char pattern[SINK_STRING_LENGTH];	// filename, may contain %d for the frame number
+	char command[SINK_STRING_LENGTH];	// run with the filename after each write (or empty)
+	double period;	// minimum time between frames (ms)
+	int queue_length;
+	int drop_policy;
+	OutputRegion region;	// part of the frame written
+	int x, y, w, h;	// the region at its pyramid level
+	FrameFanout *fanout;
+	
+	SharedFrame **queue;	// frames waiting to be written
+	int head, count;
+	Mutex queue_lock;
+	Semaphore frames_waiting;
+	Thread thread;
+	int stopping;
+	
+	double last_accepted;	// time of the last frame accepted (ms)
+	int accepted, written, dropped;
+	double write_time;	// total time spent writing (ms)
+};
+
+// Hands each captured frame to several sinks (files written
+// at their own rates) without copying it for each one. Every
+// sink writes from its own thread, and a sink that falls
+// behind drops frames from its queue, so the capture thread
+// never waits for a sink. Frame buffers come from a pool
+// which is big enough for every sink's queue to be full.
+// Each sink writes a region of one level of the frame's
+// pyramid, and sinks writing the same region share a copy.
+class FrameFanout
+{
+public:
+	FrameFanout();
+	~FrameFanout();
+	
+	// Add a sink before start is called. region may be
+	// NULL for the whole frame at full size.
+	int addSink(char *pattern, double period, int queue_length,
+		int drop_policy, char *command, OutputRegion *region);
+	int numSinks();
+	
+	// Allocate the frame pool and start the sink threads
+	int start(int w, int h);
+	
+	// Number of pyramid levels needed by the sinks which are
+	// due a frame at this time (0 if none are due)
+	int levelsDue(double time);
+	
+	// Share a bottom-up BGR frame, whose pyramid has been
+	// built up to levelsDue levels, with every sink that is
+	// due a frame. Called from the capture thread.
+	void submit(ImagePyramid *pyramid, int frame_number, double time);
+	
+	// Write out the frames still queued and stop the threads
+	void stop();
+	
+	void printStats(char *label);
+	
+	// Frame counts of sink n
+	void sinkCounts(int n, int *accepted, int *written, int *dropped);
+	
+	// Number of pool buffers held by sinks (none once stopped)
+	int framesInUse();
+	
+private:
+	int width, height;
+	int frame_size;
+	FrameSink sinks[MAX_SINKS];
+	int num_sinks;
+	int running;
+	
+	SharedFrame *pool;
+	int pool_size;
+	SharedFrame **free_frames;
+	int num_free;
+	Mutex pool_lock;
+	int pool_drops;	// frames not shared because no buffer was free
+	
+	int isDue(FrameSink *sink, double time);
+	SharedFrame *acquire();
+	void release(SharedFrame *frame);
+	void enqueue(FrameSink *sink, SharedFrame *frame);
+	static void sinkThread(void *sink);
+};
+
+#endif // FRAMEFANOUT_H
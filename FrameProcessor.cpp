@@ -0,0 +1,581 @@
+//
+// FrameProcessor.cpp - FrameProcessor class
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FrameProcessor.h"
+#include "Platform.h"
+#include "ImageUtils.h"
+
+FrameProcessor::FrameProcessor(int w, int h)
+{
+	// Initialize any private variables here
+	width = w;
+	height = h;
+	save_frame_to_file = 0;
+	files_saved = 0;
+	run_command = 0;
+	frame_count = 0;
+	frame_number = 0;
+	grey = NULL;
+	background_enabled = 0;
+	save_foreground_mask = 0;
+	foreground_mask = NULL;
+	stacking_enabled = 0;
+	stacked_frame = NULL;
+	remap_enabled = 0;
+	remap_time = 0;
+	processing_time = 0;
+	feature_tracking_enabled = 0;
+	marker_detection_enabled = 0;
+	stats_mode = 0;
+	stereo_pair = NULL;
+	stereo_side = STEREO_LEFT;
+	output_pyramid.initBGR(w, h, 1);
+	memset(&save_region, 0, sizeof(save_region));
+	save_x = save_y = 0;
+	save_w = w;
+	save_h = h;
+	save_buffer = NULL;
+	first_frame_time = 0;
+	last_frame_time = 0;
+	strcpy(label, "");
+	record_size = RECORD_LENGTH;
+	record = new char[record_size];
+}
+
+FrameProcessor::~FrameProcessor()
+{
+	delete [] record;
+	delete [] grey;
+	delete [] foreground_mask;
+	delete [] stacked_frame;
+	delete [] save_buffer;
+}
+
+//
+// This function is called to process the image data
+// of each frame
+//
+void FrameProcessor::process(unsigned char *pIn, unsigned char *pOut, int number, double frame_time)
+{
+	FILE *f;
+	unsigned char *pFrame;
+	char *r;
+	double start_time = get_time_ms();
+	
+	// Copy the input frame to the output frame,
+	// correcting lens distortion on the way if enabled
+	if (remap_enabled)
+	{
+		frame_remapper.process(pIn, pOut);
+		remap_time += get_time_ms() - start_time;
+	}
+	else if (pOut != pIn)
+	{
+		memcpy(pOut, pIn, 3*width*height);
+	}
+	
+	// All of the following stages work on the output frame
+	pFrame = pOut;
+	
+	frame_number = number;
+	if (frame_count++ == 0) first_frame_time = start_time;
+	last_frame_time = start_time;
+	
+	// Track colour targets if any have been specified and
+	// print one line per frame to stdout in the form
+	// "track FRAME LATENCY_MS AREA X Y [AREA X Y ...]"
+	if (colour_tracker.numTargets() > 0)
+	{
+		ColourTarget targets[MAX_COLOUR_CLASSES];
+		colour_tracker.process(pFrame, width, height, targets);
+		
+		r = record + sprintf(record, "%strack %d %.2f",
+			label, frame_number, get_time_ms() - start_time);
+		for (int c=0 ; c<colour_tracker.numTargets() ; ++c)
+		{
+			r += sprintf(r, " %d %.1f %.1f", targets[c].area, targets[c].x, targets[c].y);
+		}
+		outputRecord(r);
+	}
+	
+	// Grey copy of the frame shared by the following stages
+	if (background_enabled || feature_tracking_enabled || marker_detection_enabled ||
+		stereo_pair || stats_mode)
+	{
+		bgr_to_grey(pFrame, grey, width, height);
+	}
+	
+	// Measure exposure, focus and change, printing them
+	// every frame if required in the form "stats FRAME
+	// LATENCY_MS FRAMES MEAN P5 P50 P95 FOCUS DARK BRIGHT HASH REPEATS"
+	if (stats_mode)
+	{
+		StatsResult stats;
+		image_stats.process(grey, &stats);
+		if (stats_mode == STATS_FRAME) outputStats(&stats, start_time);
+	}
+	
+	// Update the background model and print the fraction
+	// of foreground pixels in the form
+	// "background FRAME LATENCY_MS FRACTION"
+	if (background_enabled)
+	{
+		double fraction = background_model.process(grey, foreground_mask);
+		
+		r = record + sprintf(record, "%sbackground %d %.2f %.4f",
+			label, frame_number, get_time_ms() - start_time, fraction);
+		outputRecord(r);
+	}
+	
+	// Track features and print their ids and positions in
+	// the form "features FRAME LATENCY_MS N ID X Y [ID X Y ...]"
+	if (feature_tracking_enabled)
+	{
+		int number_features = feature_tracker.process(grey);
+		Feature *features = feature_tracker.features();
+		
+		r = record + sprintf(record, "%sfeatures %d %.2f %d",
+			label, frame_number, get_time_ms() - start_time, number_features);
+		for (int k=0 ; k<number_features ; ++k)
+		{
+			r += sprintf(r, " %d %.1f %.1f", features[k].id, features[k].x, features[k].y);
+		}
+		outputRecord(r);
+	}
+	
+	// Detect markers and print their ids and corners in the
+	// form "markers FRAME LATENCY_MS N ID X1 Y1 X2 Y2 X3 Y3 X4 Y4 ..."
+	// with the corners clockwise from the marker's top-left
+	if (marker_detection_enabled)
+	{
+		int number_markers = marker_detector.process(grey);
+		Marker *markers = marker_detector.markers();
+		
+		r = record + sprintf(record, "%smarkers %d %.2f %d",
+			label, frame_number, get_time_ms() - start_time, number_markers);
+		for (int k=0 ; k<number_markers ; ++k)
+		{
+			r += sprintf(r, " %d", markers[k].id);
+			for (int c=0 ; c<4 ; ++c)
+			{
+				r += sprintf(r, " %.2f %.2f", markers[k].x[c], markers[k].y[c]);
+			}
+		}
+		outputRecord(r);
+	}
+	
+	// Offer the frame to the stereo pair. If it completes a
+	// pair, print the pairing skew and nearest obstacle in each
+	// strip in the form "stereo PAIR SKEW_MS MATCH_MS LATENCY_MS
+	// D1 D2 ...". Frames are paired on their frame times.
+	if (stereo_pair)
+	{
+		StereoResult stereo_result;
+		if (stereo_pair->submit(stereo_side, grey, frame_time, &stereo_result))
+		{
+			r = record + sprintf(record, "%sstereo %d %.2f %.2f %.2f", label,
+				stereo_result.pair_number, stereo_result.skew,
+				stereo_result.match_time, get_time_ms() - start_time);
+			for (int k=0 ; k<STEREO_STRIPS ; ++k)
+			{
+				r += sprintf(r, " %d", stereo_result.strip_disparities[k]);
+			}
+			outputRecord(r);
+		}
+	}
+	
+	// Add every frame to the stack, so the saved image
+	// is made from all frames since the last capture
+	if (stacking_enabled) frame_stacker.add(pFrame);
+	
+	// Build the frame's pyramid once, up to the highest
+	// level needed by the outputs writing this frame
+	int levels = frame_fanout.levelsDue(frame_time);
+	if (save_frame_to_file && !stacking_enabled && save_region.level >= levels)
+		levels = save_region.level + 1;
+	if (levels > 0) output_pyramid.build(pFrame, levels);
+	
+	// Share the frame with any sinks that are due one
+	if (frame_fanout.numSinks() > 0) frame_fanout.submit(&output_pyramid, frame_number, frame_time);
+	
+	// Output image to PGM or BMP file if flag is set
+	if (save_frame_to_file)
+	{
+		if (stacking_enabled)
+		{
+			fprintf(stderr, "Stacked %d frames\n",
+				frame_stacker.result(stacked_frame));
+			pFrame = stacked_frame;
+		}
+		
+		// Copy the region to be saved from its pyramid level,
+		// building the pyramid of the stacked frame (or of this
+		// frame if the save was requested after it was built)
+		if (save_buffer)
+		{
+			int level = save_region.level;
+			if (stacking_enabled || levels <= level) output_pyramid.build(pFrame, level + 1);
+			crop_frame(output_pyramid.level(level), output_pyramid.levelWidth(level),
+				output_pyramid.levelHeight(level), save_x, save_y, save_w, save_h, save_buffer);
+			pFrame = save_buffer;
+		}
+		
+		// Check if file exists already
+		if ((f = fopen(filename, "r")))
+		{
+			// File can be opened for reading, so it exists
+			fclose(f);
+			
+			// Nasty hack to check if file is currently open
+			// in another program. There had been a problem
+			// without this because another program could be
+			// in the middle of reading the file.
+			while (rename(filename, filename) != 0);
+		}
+			
+		fprintf(stderr, "Saving frame as %s\n", filename);
+	
+		if (strcmp(filename+(strlen(filename)-4), ".pgm") == 0)
+		{
+			// Write current frame to PGM file
+			write_pgm_file(filename, pFrame, save_w, save_h);
+		}
+		else if (strcmp(filename+(strlen(filename)-4), ".bmp") == 0)
+		{
+			// Write current frame to BMP file
+			write_bmp_file(filename, pFrame, save_w, save_h);
+		}
+		
+		// Print the statistics of all frames since the
+		// last one saved
+		if (stats_mode == STATS_PERIOD)
+		{
+			StatsResult stats;
+			image_stats.summary(&stats);
+			outputStats(&stats, start_time);
+		}
+		
+		// Save the foreground mask alongside the frame
+		if (background_enabled && save_foreground_mask)
+		{
+			make_extra_filename(text_buffer, filename, "_fg");
+			write_grey_pgm_file(text_buffer, foreground_mask, width, height);
+		}
+		
+		// Save the disparity map of the next stereo pair
+		// alongside the left camera's frame
+		if (stereo_pair && stereo_side == STEREO_LEFT)
+		{
+			make_extra_filename(text_buffer, filename, "_disparity");
+			stereo_pair->saveNextDisparity(text_buffer);
+		}
+		
+		// Increment frame counter and reset flag
+		files_saved++;
+		save_frame_to_file = 0;
+		
+		// Execute frame processing program if user has
+		// specified one
+		sprintf(text_buffer, "%s %s", command, filename);
+		if (run_command) system(text_buffer);
+	}
+	
+	processing_time += get_time_ms() - start_time;
+	
+}
+
+//
+// This function is used to request that the next frame
+// captured be saved to a PGM file
+//
+void FrameProcessor::saveNextFrameToFile(char *output_filename)
+{
+	// Remember filename and set flag to request dump
+	// of next frame to PGM file
+	strncpy(filename, output_filename, STRING_LENGTH - 1);
+	filename[STRING_LENGTH - 1] = '\0';
+	save_frame_to_file = 1;
+}
+
+//
+// This function sets the part of each frame which is saved
+// to file, which can be a region of interest and / or a
+// smaller copy of the frame from its pyramid
+//
+int FrameProcessor::setSaveRegion(OutputRegion *region)
+{
+	int x, y, w, h;
+	
+	if (level_region(region, width, height, &x, &y, &w, &h) != 0) return 1;
+	if (useOutputLevels(region->level + 1) != 0) return 1;
+	
+	save_region = *region;
+	save_x = x;
+	save_y = y;
+	save_w = w;
+	save_h = h;
+	delete [] save_buffer;
+	save_buffer = NULL;
+	if (region->level > 0 || w != width || h != height)
+	{
+		save_buffer = new unsigned char[3*w*h];
+	}
+	
+	return 0;
+}
+
+//
+// This function makes sure the output pyramid has at least
+// the specified number of levels
+//
+int FrameProcessor::useOutputLevels(int levels)
+{
+	if (levels <= output_pyramid.levels()) return 0;
+	return output_pyramid.initBGR(width, height, levels);
+}
+
+//
+// This function returns the number of image files
+// that have been saved since the filter was created
+//
+int FrameProcessor::filesSaved()
+{
+	return files_saved;
+}
+
+//
+// This function is used to designate an external program
+// which will be launched each time an image file is saved
+//
+void FrameProcessor::setCommand(char *command_string)
+{
+	// Set flag to run command after each file is saved
+	// and remember the command to run
+	strncpy(command, command_string, STRING_LENGTH - 1);
+	command[STRING_LENGTH - 1] = '\0';
+	run_command = 1;
+}
+
+//
+// This function is used to add a colour class which
+// will be tracked in every frame. It returns the class
+// number, or -1 if too many classes have been added.
+//
+int FrameProcessor::addColourTarget(
+	int hmin, int hmax, int smin, int smax, int vmin, int vmax)
+{
+	return colour_tracker.addTarget(hmin, hmax, smin, smax, vmin, vmax);
+}
+
+//
+// This function is used to enable the background model
+// stage. If save_mask is non-zero, the foreground mask is
+// also saved as a PGM file each time a frame is saved.
+//
+void FrameProcessor::enableBackgroundModel(int save_mask)
+{
+	if (grey == NULL) grey = new unsigned char[width*height];
+	if (foreground_mask == NULL) foreground_mask = new unsigned char[width*height];
+	background_model.init(width, height, BACKGROUND_RATE_SHIFT, BACKGROUND_THRESHOLD);
+	save_foreground_mask = save_mask;
+	background_enabled = 1;
+}
+
+//
+// This function is used to enable multi-frame stacking.
+// mode is STACK_MEAN or STACK_MEDIAN and reject is the
+// outlier rejection threshold in grey levels (0 for none).
+//
+void FrameProcessor::enableStacking(int mode, int reject)
+{
+	if (stacked_frame == NULL) stacked_frame = new unsigned char[3*width*height];
+	frame_stacker.init(3*width*height, mode, reject);
+	stacking_enabled = 1;
+}
+
+//
+// This function is used to enable lens distortion
+// correction. The remap table is built here, once,
+// for the frame size passed to the constructor.
+//
+int FrameProcessor::enableLensCorrection(char *calibration_filename)
+{
+	if (frame_remapper.load(calibration_filename, width, height) != 0) return 1;
+	
+	fprintf(stderr, "Lens correction table: %d KB\n",
+		frame_remapper.tableSize() / 1024);
+	remap_enabled = 1;
+	return 0;
+}
+
+//
+// This function is used to enable feature tracking
+// with up to max_features features at a time
+//
+int FrameProcessor::enableFeatureTracking(int max_features)
+{
+	if (feature_tracker.init(width, height, max_features) != 0) return 1;
+	
+	if (grey == NULL) grey = new unsigned char[width*height];
+	
+	// Make sure the record buffer can hold every feature
+	if (record_size < RECORD_LENGTH + 32*max_features)
+	{
+		delete [] record;
+		record_size = RECORD_LENGTH + 32*max_features;
+		record = new char[record_size];
+	}
+	
+	feature_tracking_enabled = 1;
+	return 0;
+}
+
+//
+// This function is used to enable marker detection
+//
+int FrameProcessor::enableMarkerDetection()
+{
+	if (marker_detector.init(width, height) != 0) return 1;
+	
+	if (grey == NULL) grey = new unsigned char[width*height];
+	
+	// Make sure the record buffer can hold every marker
+	if (record_size < RECORD_LENGTH + 100*MAX_MARKERS)
+	{
+		delete [] record;
+		record_size = RECORD_LENGTH + 100*MAX_MARKERS;
+		record = new char[record_size];
+	}
+	
+	marker_detection_enabled = 1;
+	return 0;
+}
+
+//
+// This function is used to enable image statistics
+//
+void FrameProcessor::enableStats(int mode)
+{
+	image_stats.init(width, height);
+	if (grey == NULL) grey = new unsigned char[width*height];
+	stats_mode = mode;
+}
+
+//
+// These functions are used to add frame sinks, start
+// them and stop them when capture has finished
+//
+int FrameProcessor::addSink(char *pattern, double period, int queue_length,
+	int drop_policy, char *command, OutputRegion *region)
+{
+	int x, y, w, h;
+	
+	if (region)
+	{
+		if (level_region(region, width, height, &x, &y, &w, &h) != 0) return 1;
+		if (useOutputLevels(region->level + 1) != 0) return 1;
+	}
+	return frame_fanout.addSink(pattern, period, queue_length, drop_policy, command, region);
+}
+
+int FrameProcessor::startSinks()
+{
+	return frame_fanout.start(width, height);
+}
+
+void FrameProcessor::stopSinks()
+{
+	frame_fanout.stop();
+}
+
+//
+// This function is used to make this filter's frames
+// the left or right images of a stereo pair
+//
+void FrameProcessor::setStereoPair(StereoPair *pair, int side)
+{
+	if (grey == NULL) grey = new unsigned char[width*height];
+	stereo_pair = pair;
+	stereo_side = side;
+}
+
+//
+// This function prints the number of frames received,
+// the frame rate and the average time spent processing
+// each frame
+//
+void FrameProcessor::printStats()
+{
+	if (frame_count == 0) return;
+	
+	fprintf(stderr, "%sframes received: %d\n", label, frame_count);
+	if (frame_count > 1)
+	{
+		fprintf(stderr, "%sframe rate: %.2f frames/s\n", label,
+			1000.0 * (frame_count - 1) / (last_frame_time - first_frame_time));
+	}
+	fprintf(stderr, "%sfiles saved: %d\n", label, files_saved);
+	fprintf(stderr, "%saverage processing time: %.2f ms/frame\n", label,
+		processing_time / frame_count);
+	if (remap_enabled)
+	{
+		fprintf(stderr, "%saverage lens correction time: %.2f ms/frame\n", label,
+			remap_time / frame_count);
+	}
+	frame_fanout.printStats(label);
+}
+
+//
+// This function returns non-zero if any enabled stage keeps
+// state from one frame to the next (so frames must be
+// processed one at a time, in order)
+//
+int FrameProcessor::isStateful()
+{
+	return background_enabled || stacking_enabled || feature_tracking_enabled ||
+		stats_mode || stereo_pair || frame_fanout.numSinks() > 0;
+}
+
+//
+// This function sets a label which is added to the start
+// of every record and statistics line, so that output from
+// several cameras can be told apart
+//
+void FrameProcessor::setLabel(char *label_string)
+{
+	strncpy(label, label_string, sizeof(label) - 1);
+	label[sizeof(label) - 1] = '\0';
+}
+
+//
+// This function prints a stats record
+//
+void FrameProcessor::outputStats(StatsResult *stats, double start_time)
+{
+	char *r = record + sprintf(record, "%sstats %d %.2f %d %.2f %d %d %d %.1f %.4f %.4f %08x %d",
+		label, frame_number, get_time_ms() - start_time, stats->frames,
+		stats->mean, stats->p5, stats->p50, stats->p95, stats->focus,
+		stats->dark, stats->bright, stats->hash, stats->repeats);
+	outputRecord(r);
+}
+
+//
+// This function finishes a record which has been written
+// into the record buffer (end points to its terminating
+// null) and prints it to stdout. The whole line is written
+// in one call so that records from different cameras'
+// threads do not get mixed up.
+//
+void FrameProcessor::outputRecord(char *end)
+{
+	strcpy(end, "\n");
+	fputs(record, stdout);
+	fflush(stdout);
+}
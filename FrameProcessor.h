@@ -0,0 +1,151 @@
+//
+// FrameProcessor.h - FrameProcessor header file
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef FRAMEPROCESSOR_H
+#define FRAMEPROCESSOR_H
+
+#include "ColourTracker.h"
+#include "BackgroundModel.h"
+#include "FrameStacker.h"
+#include "FrameRemapper.h"
+#include "FeatureTracker.h"
+#include "MarkerDetector.h"
+#include "ImageStats.h"
+#include "FrameFanout.h"
+#include "StereoPair.h"
+
+// Used for various strings - filenames, command line args, etc
+#define STRING_LENGTH 200
+
+// Size of the buffer used to build each line of output
+// (enlarged if necessary by enableFeatureTracking)
+#define RECORD_LENGTH 1024
+
+// Runs the processing and output stages on each frame.
+// It does not depend on DirectShow, so the same stages
+// can be run on live frames (FrameTransformFilter) or on
+// recorded ones (RobotReplay). Each camera has its own
+// FrameProcessor, and none of its buffers are shared with
+// other cameras, whose frames are processed at the same time
+// on their own threads.
+class FrameProcessor
+{
+public:
+	FrameProcessor(int w, int h);
+	~FrameProcessor();
+	
+	// Process one bottom-up BGR frame from pIn, leaving the
+	// (lens corrected) frame in pOut. frame_time is when the
+	// frame was captured in ms, and is used to pair stereo
+	// frames and to rate limit sinks.
+	void process(unsigned char *pIn, unsigned char *pOut, int frame_number, double frame_time);
+	
+	// Provide a function to allow a PGM file copy of the
+	// next frame to be requested
+	void saveNextFrameToFile(char *filename);
+	
+	// Save only a region of each saved frame, at a level of
+	// the frame's pyramid. Returns 0 on success.
+	int setSaveRegion(OutputRegion *region);
+	void setCommand(char *command);
+	int filesSaved();
+	
+	// Add a colour class to track in every frame (see ColourTracker)
+	int addColourTarget(int hmin, int hmax, int smin, int smax, int vmin, int vmax);
+	
+	// Enable the background model / foreground mask stage
+	void enableBackgroundModel(int save_mask);
+	
+	// Save the mean or median of all frames received between
+	// captures rather than a single frame (see FrameStacker)
+	void enableStacking(int mode, int reject);
+	
+	// Correct lens distortion using the calibration in the
+	// specified file (see FrameRemapper). Returns 0 on success.
+	int enableLensCorrection(char *calibration_filename);
+	
+	// Enable FAST corner detection and Lucas-Kanade tracking
+	int enableFeatureTracking(int max_features);
+	
+	// Enable detection of square fiducial markers
+	int enableMarkerDetection();
+	
+	// Print image statistics every frame (STATS_FRAME) or
+	// once per saved frame (STATS_PERIOD)
+	void enableStats(int mode);
+	
+	// Add a sink which writes frames (or a region of them, at
+	// a pyramid level) to files at its own rate, then start
+	// all sinks once they have been added
+	int addSink(char *pattern, double period, int queue_length,
+		int drop_policy, char *command, OutputRegion *region);
+	int startSinks();
+	
+	// Write out frames still queued for sinks and stop them
+	void stopSinks();
+	
+	// Send each frame to a stereo pair as the left or right image
+	void setStereoPair(StereoPair *pair, int side);
+	
+	// Returns non-zero if any enabled stage depends on earlier
+	// frames, in which case frames must be processed in order
+	int isStateful();
+	
+	// Print frame and timing statistics to stderr
+	void printStats();
+	
+	// Set a label (e.g. "cam2 ") for the start of each output line
+	void setLabel(char *label_string);
+
+private:
+	int width; // video frame width in pixels
+	int height; // video frame height in pixels
+	int save_frame_to_file;	// flag to request saving next frame to PGM file
+	char filename[STRING_LENGTH];	// filename to use when saving a capture frame to file
+	int files_saved;	// counter for number of frames saved to PGM files
+	int run_command;	// flag to execute program after each file capture
+	char command[STRING_LENGTH];	// command to run after each image file is saved
+	int frame_count;	// number of frames processed
+	int frame_number;	// number of the current frame (printed in records)
+	ColourTracker colour_tracker;	// colour target tracking stage
+	unsigned char *grey;	// top-down grey copy of the current frame
+	int background_enabled;	// flag to enable the background model stage
+	int save_foreground_mask;	// flag to save the mask alongside each image file
+	unsigned char *foreground_mask;	// foreground mask for the current frame
+	BackgroundModel background_model;	// background model stage
+	int stacking_enabled;	// flag to enable multi-frame stacking
+	unsigned char *stacked_frame;	// stacked frame to be saved
+	FrameStacker frame_stacker;	// multi-frame stacking stage
+	int remap_enabled;	// flag to enable lens correction
+	FrameRemapper frame_remapper;	// lens correction stage
+	double remap_time;	// total time spent on lens correction (ms)
+	double processing_time;	// total time spent processing frames (ms)
+	int feature_tracking_enabled;	// flag to enable feature tracking
+	FeatureTracker feature_tracker;	// feature tracking stage
+	int marker_detection_enabled;	// flag to enable marker detection
+	MarkerDetector marker_detector;	// marker detection stage
+	int stats_mode;	// 0, STATS_FRAME or STATS_PERIOD
+	ImageStats image_stats;	// image statistics stage
+	FrameFanout frame_fanout;	// sinks sharing each frame
+	ImagePyramid output_pyramid;	// smaller copies of the frame, shared by the outputs
+	OutputRegion save_region;	// part of the frame saved to file
+	int save_x, save_y, save_w, save_h;	// save_region at its pyramid level
+	unsigned char *save_buffer;	// saved region (NULL if the whole frame is saved)
+	StereoPair *stereo_pair;	// stereo pair shared with another camera (or NULL)
+	int stereo_side;	// STEREO_LEFT or STEREO_RIGHT
+	double first_frame_time;	// time the first frame was received (ms)
+	double last_frame_time;	// time the latest frame was received (ms)
+	char label[20];	// label printed at the start of each output line
+	char text_buffer[400];	// used for filenames and commands
+	char *record;	// buffer used to build each line of output
+	int record_size;	// size of the record buffer
+	
+	int useOutputLevels(int levels);
+	void outputRecord(char *end);
+	void outputStats(StatsResult *stats, double start_time);
+};
+
+#endif // FRAMEPROCESSOR_H
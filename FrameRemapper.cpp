@@ -0,0 +1,247 @@
+//
+// FrameRemapper.cpp - FrameRemapper class
+//
+// Website: http://batchloaf.wordpress.com
+//
+// The distortion model is the usual Brown-Conrady model
+// (as used by OpenCV and the Caltech calibration toolbox).
+// The calibration file is plain text containing
+//
+//		fx fy cx cy
+//		k1 k2 p1 p2 k3
+//		h11 h12 h13 h21 h22 h23 h31 h32 h33	(optional)
+//
+// where the optional homography maps each output pixel to
+// a pixel of the ideal (undistorted) camera image. This
+// can be used to rectify the ground plane or a stereo pair.
+//
+// For every output pixel the table holds the offset of the
+// top-left source pixel and two 8-bit bilinear fractions
+// (stored in 16 bits each, since a clamped edge pixel uses a
+// fraction of exactly one), i.e. 8 bytes per pixel. Pixels
+// are interpolated along the rows first and then between the
+// rows, which keeps the error within 1 grey level of exact
+// bilinear interpolation even across a black/white edge.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "FrameRemapper.h"
+#include "Platform.h"
+
+FrameRemapper::FrameRemapper()
+{
+	width = 0;
+	height = 0;
+	offsets = NULL;
+	fractions = NULL;
+}
+
+FrameRemapper::~FrameRemapper()
+{
+	delete [] offsets;
+	delete [] fractions;
+}
+
+int FrameRemapper::load(char *filename, int w, int h)
+{
+	FILE *f;
+	CameraCalibration c;
+	
+	f = fopen(filename, "r");
+	if (f == NULL) return 1;
+	
+	if (fscanf(f, "%lf %lf %lf %lf", &c.fx, &c.fy, &c.cx, &c.cy) != 4 ||
+		fscanf(f, "%lf %lf %lf %lf %lf", &c.k1, &c.k2, &c.p1, &c.p2, &c.k3) != 5)
+	{
+		fclose(f);
+		return 2;
+	}
+	
+	// The homography is optional
+	c.use_homography = 1;
+	for (int i=0 ; i<9 ; ++i)
+	{
+		if (fscanf(f, "%lf", &c.H[i]) != 1) c.use_homography = 0;
+	}
+	fclose(f);
+	
+	return init(&c, w, h);
+}
+
+int FrameRemapper::sourcePosition(double u, double v, double *sx, double *sy)
+{
+	double X, Y, Z, x, y, r2, radial, xd, yd;
+	
+	// Output pixel to undistorted camera pixel
+	if (cal.use_homography)
+	{
+		X = cal.H[0]*u + cal.H[1]*v + cal.H[2];
+		Y = cal.H[3]*u + cal.H[4]*v + cal.H[5];
+		Z = cal.H[6]*u + cal.H[7]*v + cal.H[8];
+		if (Z == 0) return 0;
+		u = X / Z;
+		v = Y / Z;
+	}
+	
+	// Apply lens distortion in normalised coordinates
+	x = (u - cal.cx) / cal.fx;
+	y = (v - cal.cy) / cal.fy;
+	r2 = x*x + y*y;
+	radial = 1 + r2*(cal.k1 + r2*(cal.k2 + r2*cal.k3));
+	xd = x*radial + 2*cal.p1*x*y + cal.p2*(r2 + 2*x*x);
+	yd = y*radial + cal.p1*(r2 + 2*y*y) + 2*cal.p2*x*y;
+	
+	*sx = cal.fx*xd + cal.cx;
+	*sy = cal.fy*yd + cal.cy;
+	
+	return (*sx >= 0 && *sx <= width-1 && *sy >= 0 && *sy <= height-1);
+}
+
+int FrameRemapper::init(CameraCalibration *calibration, int w, int h)
+{
+	int u, v, x0, y0, fx, fy, n;
+	double sx, sy;
+	int one = 1 << REMAP_FRACTION_BITS;
+	
+	delete [] offsets;
+	delete [] fractions;
+	
+	cal = *calibration;
+	width = w;
+	height = h;
+	offsets = new int[w*h];
+	fractions = new unsigned int[w*h];
+	
+	// Output pixels are stored in top-down order, but the
+	// offsets point into the bottom-up source frame
+	for (v=0, n=0 ; v<h ; ++v)
+	{
+		for (u=0 ; u<w ; ++u, ++n)
+		{
+			if (!sourcePosition(u, v, &sx, &sy))
+			{
+				offsets[n] = -1;
+				fractions[n] = 0;
+				continue;
+			}
+			
+			x0 = (int)sx;
+			y0 = (int)sy;
+			fx = (int)((sx - x0) * one + 0.5);
+			fy = (int)((sy - y0) * one + 0.5);
+			if (fx == one) { x0++; fx = 0; }
+			if (fy == one) { y0++; fy = 0; }
+			
+			// Keep the 2x2 neighbourhood inside the frame
+			if (x0 > w-2) { x0 = w-2; fx = one; }
+			if (y0 > h-2) { y0 = h-2; fy = one; }
+			
+			offsets[n] = 3*((h-1-y0)*w + x0);
+			fractions[n] = (unsigned int)(fx | (fy << 16));
+		}
+	}
+	
+	return 0;
+}
+
+int FrameRemapper::tableSize()
+{
+	return width * height * (sizeof(int) + sizeof(unsigned int));
+}
+
+//
+// Bilinear interpolation of one output pixel
+//
+static inline void remap_pixel(unsigned char *pSrc, int offset,
+	unsigned int fraction, int row_bytes, int frame_bytes, unsigned char *q)
+{
+	int fx = fraction & 0xffff;
+	int fy = fraction >> 16;
+	int one = 1 << REMAP_FRACTION_BITS;
+	unsigned char *p0 = pSrc + offset;
+	unsigned char *p1 = p0 - row_bytes;	// next row down the image
+	
+#ifdef USE_SSE2
+	// 8 byte loads read 2 bytes past the pair of pixels,
+	// which is only a problem right at the end of the frame
+	if (offset + 8 <= frame_bytes)
+	{
+		__m128i zero = _mm_setzero_si128();
+		__m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)p0), zero);
+		__m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)p1), zero);
+		__m128i round = _mm_set1_epi32(1 << (REMAP_ROW_SHIFT - 1));
+		
+		// Interleave each component with its right hand neighbour
+		// and interpolate along both rows with multiply-adds
+		__m128i wx = _mm_set1_epi32((one - fx) | (fx << 16));
+		a = _mm_unpacklo_epi16(a, _mm_srli_si128(a, 6));
+		b = _mm_unpacklo_epi16(b, _mm_srli_si128(b, 6));
+		a = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(a, wx), round), REMAP_ROW_SHIFT);
+		b = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(b, wx), round), REMAP_ROW_SHIFT);
+		
+		// Interleave the two rows and interpolate between them
+		__m128i s = _mm_packs_epi32(a, b);
+		s = _mm_unpacklo_epi16(s, _mm_srli_si128(s, 8));
+		s = _mm_madd_epi16(s, _mm_set1_epi32((one - fy) | (fy << 16)));
+		s = _mm_srli_epi32(_mm_add_epi32(s, _mm_set1_epi32(1 << (2*REMAP_FRACTION_BITS-REMAP_ROW_SHIFT-1))),
+			2*REMAP_FRACTION_BITS - REMAP_ROW_SHIFT);
+		s = _mm_packs_epi32(s, s);
+		int bgr = _mm_cvtsi128_si32(_mm_packus_epi16(s, s));
+		q[0] = (unsigned char)bgr;
+		q[1] = (unsigned char)(bgr >> 8);
+		q[2] = (unsigned char)(bgr >> 16);
+		return;
+	}
+#else
+	(void)frame_bytes;	// only needed to guard the SSE2 loads
+#endif
+	
+	// Same arithmetic as the SSE2 code, so the results match
+	for (int c=0 ; c<3 ; ++c)
+	{
+		int a = ((one - fx)*p0[c] + fx*p0[c+3] + (1 << (REMAP_ROW_SHIFT-1))) >> REMAP_ROW_SHIFT;
+		int b = ((one - fx)*p1[c] + fx*p1[c+3] + (1 << (REMAP_ROW_SHIFT-1))) >> REMAP_ROW_SHIFT;
+		q[c] = (unsigned char)(((one - fy)*a + fy*b
+			+ (1 << (2*REMAP_FRACTION_BITS-REMAP_ROW_SHIFT-1))) >> (2*REMAP_FRACTION_BITS-REMAP_ROW_SHIFT));
+	}
+}
+
+void FrameRemapper::process(unsigned char *pSrc, unsigned char *pDest)
+{
+	int tiles_across = (width + REMAP_TILE_WIDTH - 1) / REMAP_TILE_WIDTH;
+	int tiles_down = (height + REMAP_TILE_HEIGHT - 1) / REMAP_TILE_HEIGHT;
+	int tiles = tiles_across * tiles_down;
+	int t;
+	
+	// Tiles keep the source pixels each thread reads close
+	// together, since the remap table bends rows into curves
+	#pragma omp parallel for schedule(dynamic)
+	for (t=0 ; t<tiles ; ++t)
+	{
+		int u0 = (t % tiles_across) * REMAP_TILE_WIDTH;
+		int v0 = (t / tiles_across) * REMAP_TILE_HEIGHT;
+		int u1 = (u0 + REMAP_TILE_WIDTH < width) ? u0 + REMAP_TILE_WIDTH : width;
+		int v1 = (v0 + REMAP_TILE_HEIGHT < height) ? v0 + REMAP_TILE_HEIGHT : height;
+		
+		for (int v=v0 ; v<v1 ; ++v)
+		{
+			unsigned char *q = pDest + 3*((height-1-v)*width + u0);
+			int n = v*width + u0;
+			
+			for (int u=u0 ; u<u1 ; ++u, ++n, q+=3)
+			{
+				if (offsets[n] < 0)
+				{
+					q[0] = q[1] = q[2] = 0;
+					continue;
+				}
+				remap_pixel(pSrc, offsets[n], fractions[n],
+					3*width, 3*width*height, q);
+			}
+		}
+	}
+}
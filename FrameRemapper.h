@@ -0,0 +1,63 @@
+//
+// FrameRemapper.h - FrameRemapper header file
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef FRAMEREMAPPER_H
+#define FRAMEREMAPPER_H
+
+// Number of fractional bits used for bilinear weights
+#define REMAP_FRACTION_BITS 8
+
+// Horizontally interpolated values are scaled down by this
+// many bits so that they fit in 16 bits for the vertical step
+#define REMAP_ROW_SHIFT (REMAP_FRACTION_BITS - 7)
+
+// Size of the output tiles processed by each thread
+#define REMAP_TILE_WIDTH 64
+#define REMAP_TILE_HEIGHT 16
+
+// Camera model loaded from a calibration file
+struct CameraCalibration
+{
+	double fx, fy, cx, cy;	// intrinsics (pixels)
+	double k1, k2, p1, p2, k3;	// radial and tangential distortion
+	int use_homography;	// set if a homography was supplied
+	double H[9];	// maps output pixels to undistorted pixels
+};
+
+// Corrects lens distortion (and optionally applies a
+// perspective transformation) using a remap table
+// which is computed once when the calibration is loaded
+class FrameRemapper
+{
+public:
+	FrameRemapper();
+	~FrameRemapper();
+	
+	// Load a calibration file and build the remap table for
+	// w x h frames. Returns 0 on success, non-zero on error.
+	int load(char *filename, int w, int h);
+	
+	// Build the remap table from a calibration already in memory
+	int init(CameraCalibration *calibration, int w, int h);
+	
+	// Remap a bottom-up BGR24 frame from pSrc into pDest
+	void process(unsigned char *pSrc, unsigned char *pDest);
+	
+	// Compute the source position of output pixel (u,v) in double
+	// precision. Returns 0 if it falls outside the source frame.
+	int sourcePosition(double u, double v, double *sx, double *sy);
+	
+	// Memory used by the remap table in bytes
+	int tableSize();
+	
+private:
+	int width, height;
+	CameraCalibration cal;
+	int *offsets;	// byte offset of top-left source pixel, or -1
+	unsigned int *fractions;	// x fraction in low 16 bits, y fraction in high 16 bits
+};
+
+#endif // FRAMEREMAPPER_H
@@ -0,0 +1,202 @@
+//
+// FrameStacker.cpp - FrameStacker class
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Frames are summed into 16-bit accumulators, which can
+// hold 256 frames without overflowing, and these are
+// added into 32-bit accumulators every 256 frames. That
+// keeps the per-frame work in cheap 16-bit SIMD adds.
+//
+// The median is approximated by nudging an estimate one
+// grey level towards each new sample, which converges on
+// the median of a long run of frames.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "FrameStacker.h"
+#include "Platform.h"
+
+FrameStacker::FrameStacker()
+{
+	bytes = 0;
+	frames = 0;
+	partial_frames = 0;
+	median_initialised = 0;
+	median = NULL;
+	sum16 = NULL;
+	sum32 = NULL;
+}
+
+FrameStacker::~FrameStacker()
+{
+	delete [] median;
+	delete [] sum16;
+	delete [] sum32;
+}
+
+int FrameStacker::init(int size, int stack_mode, int reject)
+{
+	delete [] median;
+	delete [] sum16;
+	delete [] sum32;
+	
+	bytes = size;
+	mode = stack_mode;
+	threshold = reject;
+	median = new unsigned char[bytes];
+	sum16 = new unsigned short[bytes];
+	sum32 = new unsigned int[bytes];
+	memset(sum16, 0, bytes * sizeof(unsigned short));
+	memset(sum32, 0, bytes * sizeof(unsigned int));
+	frames = 0;
+	partial_frames = 0;
+	median_initialised = 0;
+	
+	return 0;
+}
+
+void FrameStacker::add(unsigned char *pBuf)
+{
+	int n = 0, v;
+	int need_mean = (mode == STACK_MEAN);
+	
+	// The median estimate is only needed for median stacking
+	// and for outlier rejection
+	int need_median = (mode == STACK_MEDIAN || threshold > 0);
+	
+	// The very first frame is the initial median estimate. The
+	// estimate is carried over from one stack to the next so
+	// that it has time to converge.
+	if (need_median && !median_initialised)
+	{
+		memcpy(median, pBuf, bytes);
+		median_initialised = 1;
+	}
+	
+#ifdef USE_SSE2
+	__m128i zero = _mm_setzero_si128();
+	__m128i one = _mm_set1_epi8(1);
+	__m128i thr = _mm_set1_epi8((char)threshold);
+	
+	for ( ; n+16<=bytes ; n+=16)
+	{
+		__m128i x = _mm_loadu_si128((__m128i *)(pBuf + n));
+		__m128i m = zero;
+		
+		// Move the median estimate one step towards the sample
+		if (need_median)
+		{
+			m = _mm_loadu_si128((__m128i *)(median + n));
+			__m128i up = _mm_min_epu8(_mm_subs_epu8(x, m), one);
+			__m128i down = _mm_min_epu8(_mm_subs_epu8(m, x), one);
+			m = _mm_sub_epi8(_mm_add_epi8(m, up), down);
+			_mm_storeu_si128((__m128i *)(median + n), m);
+		}
+		
+		if (!need_mean) continue;
+		
+		// Clip outliers to within threshold of the median
+		if (threshold > 0)
+		{
+			x = _mm_max_epu8(x, _mm_subs_epu8(m, thr));
+			x = _mm_min_epu8(x, _mm_adds_epu8(m, thr));
+		}
+		
+		__m128i s0 = _mm_loadu_si128((__m128i *)(sum16 + n));
+		__m128i s1 = _mm_loadu_si128((__m128i *)(sum16 + n + 8));
+		s0 = _mm_add_epi16(s0, _mm_unpacklo_epi8(x, zero));
+		s1 = _mm_add_epi16(s1, _mm_unpackhi_epi8(x, zero));
+		_mm_storeu_si128((__m128i *)(sum16 + n), s0);
+		_mm_storeu_si128((__m128i *)(sum16 + n + 8), s1);
+	}
+#endif
+	
+	for ( ; n<bytes ; ++n)
+	{
+		v = pBuf[n];
+		if (need_median)
+		{
+			if (v > median[n]) median[n]++;
+			else if (v < median[n]) median[n]--;
+		}
+		
+		if (!need_mean) continue;
+		
+		if (threshold > 0)
+		{
+			if (v < median[n] - threshold) v = median[n] - threshold;
+			if (v > median[n] + threshold) v = median[n] + threshold;
+		}
+		sum16[n] += v;
+	}
+	
+	frames++;
+	
+	// 256 frames of 255 is the most sum16 can hold
+	if (need_mean && ++partial_frames == 256) flush();
+}
+
+//
+// Add the 16-bit accumulators into the 32-bit ones and clear them
+//
+void FrameStacker::flush()
+{
+	int n = 0;
+	
+#ifdef USE_SSE2
+	__m128i zero = _mm_setzero_si128();
+	
+	for ( ; n+8<=bytes ; n+=8)
+	{
+		__m128i s = _mm_loadu_si128((__m128i *)(sum16 + n));
+		__m128i t0 = _mm_loadu_si128((__m128i *)(sum32 + n));
+		__m128i t1 = _mm_loadu_si128((__m128i *)(sum32 + n + 4));
+		t0 = _mm_add_epi32(t0, _mm_unpacklo_epi16(s, zero));
+		t1 = _mm_add_epi32(t1, _mm_unpackhi_epi16(s, zero));
+		_mm_storeu_si128((__m128i *)(sum32 + n), t0);
+		_mm_storeu_si128((__m128i *)(sum32 + n + 4), t1);
+		_mm_storeu_si128((__m128i *)(sum16 + n), zero);
+	}
+#endif
+	
+	for ( ; n<bytes ; ++n)
+	{
+		sum32[n] += sum16[n];
+		sum16[n] = 0;
+	}
+	
+	partial_frames = 0;
+}
+
+int FrameStacker::result(unsigned char *pResult)
+{
+	int n, stacked = frames;
+	
+	if (frames == 0) return 0;
+	
+	if (mode == STACK_MEDIAN)
+	{
+		memcpy(pResult, median, bytes);
+	}
+	else
+	{
+		// Rounded mean of all frames, then empty the accumulators
+		flush();
+		for (n=0 ; n<bytes ; ++n)
+		{
+			pResult[n] = (unsigned char)((sum32[n] + frames/2) / frames);
+			sum32[n] = 0;
+		}
+	}
+	
+	frames = 0;
+	return stacked;
+}
+
+int FrameStacker::framesStacked()
+{
+	return frames;
+}
@@ -0,0 +1,52 @@
+//
+// FrameStacker.h - FrameStacker header file
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef FRAMESTACKER_H
+#define FRAMESTACKER_H
+
+// Stacking modes
+#define STACK_MEAN 1
+#define STACK_MEDIAN 2
+
+// Accumulates every frame received between captures so that
+// the saved image is the mean (or approximate median) of all
+// of them rather than a single noisy exposure
+class FrameStacker
+{
+public:
+	FrameStacker();
+	~FrameStacker();
+	
+	// Allocate accumulators for frames of size bytes. If
+	// reject is non-zero, samples further than reject grey
+	// levels from the running median are clipped before
+	// being added to the mean.
+	int init(int size, int stack_mode, int reject);
+	
+	// Add a frame to the stack
+	void add(unsigned char *pBuf);
+	
+	// Write the stacked frame into pResult, then empty
+	// the stack. Returns the number of frames stacked.
+	int result(unsigned char *pResult);
+	
+	int framesStacked();
+	
+private:
+	int bytes;	// number of bytes per frame
+	int mode;	// STACK_MEAN or STACK_MEDIAN
+	int threshold;	// outlier rejection threshold (0 for none)
+	int frames;	// frames added since the last result
+	int partial_frames;	// frames added to sum16 since it was last flushed
+	int median_initialised;	// set once the median estimate has been seeded
+	unsigned char *median;	// running median estimate
+	unsigned short *sum16;	// sum of up to 256 frames
+	unsigned int *sum32;	// sum of all frames flushed from sum16
+	
+	void flush();
+};
+
+#endif // FRAMESTACKER_H
@@ -17,26 +17,20 @@
 #include <initguid.h>
 
 #include "FrameTransformFilter.h"
-
-// Used for various strings - filenames, command line args, etc
-// (also defined in RobotEyez.cpp)
-#define STRING_LENGTH 200
-
-// Function prototype
-int write_pgm_file(char *, unsigned char *, int, int);
-int write_bmp_file(char *, unsigned char *, int, int);
-
-char text_buffer[2*STRING_LENGTH];
+#include "Platform.h"
 
 FrameTransformFilter::FrameTransformFilter(int w, int h)
-  : CTransformFilter(NAME("My Frame Transforming Filter"), 0, CLSID_FrameTransformFilter)
+  : CTransformFilter(NAME("My Frame Transforming Filter"), 0, CLSID_FrameTransformFilter),
+    frame_processor(w, h)
 {
 	// Initialize any private variables here
 	width = w;
 	height = h;
-	save_frame_to_file = 0;
-	files_saved = 0;
-	run_command = 0;
+	frame_count = 0;
+}
+
+FrameTransformFilter::~FrameTransformFilter()
+{
 }
 
 //
@@ -186,175 +180,39 @@ HRESULT FrameTransformFilter::DecideBufferSize(
 HRESULT FrameTransformFilter::Transform(
 	IMediaSample *pSource, IMediaSample *pDest)
 {
-	FILE *f;
 	BYTE *pBufferIn, *pBufferOut;
 	HRESULT hr;
+	REFERENCE_TIME sample_start, sample_stop;
 	
 	// Get pointers to the underlying buffers.
 	if (FAILED(hr = pSource->GetPointer(&pBufferIn))) return hr;
 	if (FAILED(hr = pDest->GetPointer(&pBufferOut))) return hr;
-
-	// Just copy data from input buffer to output buffer
-	memcpy(pBufferOut, pBufferIn, pSource->GetSize());
 	
 	pDest->SetActualDataLength(pSource->GetActualDataLength());
 	pDest->SetSyncPoint(TRUE);
 	
-	// Output image to PGM or BMP file if flag is set
-	if (save_frame_to_file)
-	{		
-		// Check if file exists already
-		if (f = fopen(filename, "r"))
-		{
-			// File can be opened for reading, so it exists
-			fclose(f);
-			
-			// Nasty hack to check if file is currently open
-			// in another program. There had been a problem
-			// without this because another program could be
-			// in the middle of reading the file.
-			while (rename(filename, filename) != 0);
-		}
-			
-		fprintf(stderr, "Saving frame as %s\n", filename);
-	
-		if (strcmp(filename+(strlen(filename)-4), ".pgm") == 0)
-		{
-			// Write current frame to PGM file
-			write_pgm_file(filename, pBufferOut, width, height);
-		}
-		else if (strcmp(filename+(strlen(filename)-4), ".bmp") == 0)
-		{
-			// Write current frame to BMP file
-			write_bmp_file(filename, pBufferIn,	width, height);
-		}
-		
-		// Increment frame counter and reset flag
-		files_saved++;
-		save_frame_to_file = 0;
-		
-		// Execute frame processing program if user has
-		// specified one
-		sprintf(text_buffer, "%s %s", command, filename);
-		if (run_command) system(text_buffer);
+	// Time the frame by its sample time where possible.
+	// Sample times are comparable between graphs that share
+	// one reference clock, which stereo pairing relies on.
+	double frame_time = get_time_ms();
+	if (SUCCEEDED(pSource->GetTime(&sample_start, &sample_stop)))
+	{
+		frame_time = ((REFERENCE_TIME)m_tStart + sample_start) / 10000.0;
 	}
 	
+	// Run the processing and output stages on the frame,
+	// leaving the processed frame in the output buffer
+	frame_processor.process(pBufferIn, pBufferOut, ++frame_count, frame_time);
+	
 	return S_OK;
 }
 
 //
-// This function is used to request that the next frame
-// captured be saved to a PGM file
-//
-void FrameTransformFilter::saveNextFrameToFile(char *output_filename)
-{
-	// Remember filename and set flag to request dump
-	// of next frame to PGM file
-	strncpy(filename, output_filename, STRING_LENGTH);
-	save_frame_to_file = 1;
-}
-
-//
-// This function returns the number of image files
-// that have been saved since the filter was created
-//
-int FrameTransformFilter::filesSaved()
-{
-	return files_saved;
-}
-
-//
-// This function is used to designate an external program
-// which will be launched each time an image file is saved
+// This function returns the processor which runs the
+// processing and output stages, so that they can be
+// configured before the graph is run
 //
-void FrameTransformFilter::setCommand(char *command_string)
+FrameProcessor *FrameTransformFilter::processor()
 {
-	// Set flag to run command after each file is saved
-	// and remember the command to run
-	strncpy(command, command_string, STRING_LENGTH);
-	run_command = 1;
-}
-
-int write_pgm_file(char *filename, unsigned char *pBuf, int w, int h)
-{
-	int x, y, val, n;
-	
-	FILE *f;
-	if (f = fopen(filename, "w"))
-	{
-		// Write current frame to PGM file
-		fprintf(f, "P2\n# Frame captured by RobotEyez\n%d %d\n255\n", w, h);
-		for (int y=h-1 ; y>=0 ; --y)
-		{
-			for (int x=0 ; x<w ; ++x)
-			{
-				n = 3*(y*w + x);
-				val = (pBuf[n] + pBuf[n+1] + pBuf[n+2]) / 3;
-				fprintf(f, "%d ", val);
-			}
-			fprintf(f, "\n");
-		}
-		fclose(f);
-	}
-	
-	return 0;
-}
-
-int write_bmp_file(char *filename, unsigned char *pBuf, int w, int h)
-{
-	int x, y;
-	
-	// Bitmap structures to be written to file
-	BITMAPFILEHEADER bfh;
-	BITMAPINFOHEADER bih;
-	
-	// Fill BITMAPFILEHEADER structure
-	memcpy((char *)&bfh.bfType, "BM", 2);
-	bfh.bfSize = sizeof(bfh) + sizeof(bih) + 3*h*w;
-	bfh.bfReserved1 = 0;
-	bfh.bfReserved2 = 0;
-	bfh.bfOffBits = sizeof(bfh) + sizeof(bih);
-	
-	// Fill BITMAPINFOHEADER structure
-	bih.biSize = sizeof(bih);
-	bih.biWidth = w;
-	bih.biHeight = h;
-	bih.biPlanes = 1;
-	bih.biBitCount = 24;
-	bih.biCompression = BI_RGB; // uncompressed 24-bit RGB
-	bih.biSizeImage = 0; // can be zero for BI_RGB bitmaps
-	bih.biXPelsPerMeter = 3780; // 96dpi equivalent
-	bih.biYPelsPerMeter = 3780;
-	bih.biClrUsed = 0;
-	bih.biClrImportant = 0;
-	
-	// Open bitmap file (binary mode)
-	FILE *f;
-	f = fopen(filename, "wb");
-	if (f == NULL) return 1;
-	
-	// Write bitmap file header
-	fwrite(&bfh, 1, sizeof(bfh), f);
-	fwrite(&bih, 1, sizeof(bih), f);
-	
-	// Write bitmap pixel data starting with the
-	// bottom line of pixels, left hand side
-	fwrite(pBuf, 1, 3*w*h, f);
-	/*
-	for (y=0 ; y<h ; ++y)
-	{
-		for (x=0 ; x<w ; ++x)
-		{
-			// Write pixel components in BGR order
-			fputc(pBuf[3*(y*w+x)+2], f);
-			fputc(pBuf[3*(y*w+x)+1], f);
-			fputc(pBuf[3*(y*w+x)], f);
-		}
-	}
-	*/
-	
-	// Close bitmap file
-	fclose(f);
-	
-	return 0;
+	return &frame_processor;
 }
@@ -13,6 +13,8 @@
 #include <dshow.h>
 #include <streams.h>
 
+#include "FrameProcessor.h"
+
 // I generated the following GUID for this filter using the
 // online GUID generator at http://www.guidgen.com/
 // {d6ece2e3-72aa-4157-b489-52c3fd693ce9}
@@ -23,14 +25,13 @@ DEFINE_GUID(CLSID_FrameTransformFilter,
 class FrameTransformFilter : public CTransformFilter
 {
 public:
-	// Constructor
+	// Constructor and destructor
 	FrameTransformFilter(int w, int h);
+	~FrameTransformFilter();
 	
-	// Provide a function to allow a PGM file copy of the
-	// next frame to be requested
-	void saveNextFrameToFile(char *filename);
-	void setCommand(char *command);
-	int filesSaved();
+	// The processor which runs the processing and output
+	// stages on each frame (see FrameProcessor)
+	FrameProcessor *processor();
 	
 	// Methods required for filters derived from CTransformFilter
 	HRESULT CheckInputType(const CMediaType *mtIn);
@@ -42,11 +43,8 @@ public:
 private:
 	int width; // video frame width in pixels
 	int height; // video frame height in pixels
-	int save_frame_to_file;	// flag to request saving next frame to PGM file
-	char filename[200];	// filename to use when saving a capture frame to file
-	int files_saved;	// counter for number of frames saved to PGM files
-	int run_command;	// flag to execute program after each file capture
-	char command[200];	// command to run after each image file is saved
+	int frame_count;	// number of frames received since the filter was created
+	FrameProcessor frame_processor;	// processing and output stages
 };
 
 #endif // FRAMETRANSFORMFILTER_H
@@ -0,0 +1,230 @@
+//
+// ImagePyramid.cpp - ImagePyramid class
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ImagePyramid.h"
+#include "Platform.h"
+
+ImagePyramid::ImagePyramid()
+{
+	num_levels = 0;
+	bgr = 0;
+	for (int n=0 ; n<MAX_PYRAMID_LEVELS ; ++n) images[n] = NULL;
+}
+
+ImagePyramid::~ImagePyramid()
+{
+	for (int n=bgr ; n<MAX_PYRAMID_LEVELS ; ++n) delete [] images[n];
+}
+
+int ImagePyramid::init(int w, int h, int number_levels)
+{
+	return allocate(w, h, number_levels, 1);
+}
+
+int ImagePyramid::initBGR(int w, int h, int number_levels)
+{
+	return allocate(w, h, number_levels, 3);
+}
+
+int ImagePyramid::allocate(int w, int h, int number_levels, int bytes_per_pixel)
+{
+	if (number_levels < 1 || number_levels > MAX_PYRAMID_LEVELS) return 1;
+	
+	for (int n=bgr ; n<MAX_PYRAMID_LEVELS ; ++n)
+	{
+		delete [] images[n];
+	}
+	for (int n=0 ; n<MAX_PYRAMID_LEVELS ; ++n) images[n] = NULL;
+	
+	bgr = (bytes_per_pixel == 3);
+	num_levels = number_levels;
+	for (int n=0 ; n<num_levels ; ++n)
+	{
+		widths[n] = w;
+		heights[n] = h;
+		if (n > 0 || !bgr) images[n] = new unsigned char[bytes_per_pixel*w*h];
+		w /= 2;
+		h /= 2;
+	}
+	
+	return 0;
+}
+
+void ImagePyramid::build(unsigned char *pGrey)
+{
+	build(pGrey, num_levels);
+}
+
+void ImagePyramid::build(unsigned char *pImage, int number_levels)
+{
+	if (number_levels > num_levels) number_levels = num_levels;
+	
+	if (bgr) images[0] = pImage;
+	else memcpy(images[0], pImage, widths[0]*heights[0]);
+	
+	for (int n=1 ; n<number_levels ; ++n)
+	{
+		if (bgr) downsample_bgr(images[n-1], widths[n-1], heights[n-1], images[n]);
+		else downsample_grey(images[n-1], widths[n-1], heights[n-1], images[n]);
+	}
+}
+
+unsigned char *ImagePyramid::level(int n)
+{
+	return images[n];
+}
+
+int ImagePyramid::levelWidth(int n)
+{
+	return widths[n];
+}
+
+int ImagePyramid::levelHeight(int n)
+{
+	return heights[n];
+}
+
+int ImagePyramid::levels()
+{
+	return num_levels;
+}
+
+void downsample_grey(unsigned char *pSrc, int w, int h, unsigned char *pDest)
+{
+	int x, y;
+	int w2 = w / 2, h2 = h / 2;
+	
+	for (y=0 ; y<h2 ; ++y)
+	{
+		unsigned char *p0 = pSrc + 2*y*w;
+		unsigned char *p1 = p0 + w;
+		unsigned char *q = pDest + y*w2;
+		x = 0;
+		
+#ifdef USE_SSE2
+		// 16 output pixels from 32 pixels of each source row
+		__m128i mask = _mm_set1_epi16(0x00ff);
+		__m128i two = _mm_set1_epi16(2);
+		for ( ; x+16<=w2 ; x+=16)
+		{
+			__m128i a0 = _mm_loadu_si128((__m128i *)(p0 + 2*x));
+			__m128i a1 = _mm_loadu_si128((__m128i *)(p0 + 2*x + 16));
+			__m128i b0 = _mm_loadu_si128((__m128i *)(p1 + 2*x));
+			__m128i b1 = _mm_loadu_si128((__m128i *)(p1 + 2*x + 16));
+			
+			// Add even and odd pixels of both rows in 16 bits
+			__m128i s0 = _mm_add_epi16(
+				_mm_add_epi16(_mm_and_si128(a0, mask), _mm_srli_epi16(a0, 8)),
+				_mm_add_epi16(_mm_and_si128(b0, mask), _mm_srli_epi16(b0, 8)));
+			__m128i s1 = _mm_add_epi16(
+				_mm_add_epi16(_mm_and_si128(a1, mask), _mm_srli_epi16(a1, 8)),
+				_mm_add_epi16(_mm_and_si128(b1, mask), _mm_srli_epi16(b1, 8)));
+			s0 = _mm_srli_epi16(_mm_add_epi16(s0, two), 2);
+			s1 = _mm_srli_epi16(_mm_add_epi16(s1, two), 2);
+			_mm_storeu_si128((__m128i *)(q + x), _mm_packus_epi16(s0, s1));
+		}
+#endif
+		
+		for ( ; x<w2 ; ++x)
+		{
+			q[x] = (unsigned char)((p0[2*x] + p0[2*x+1] + p1[2*x] + p1[2*x+1] + 2) >> 2);
+		}
+	}
+}
+
+//
+// Each output byte is the rounded mean of the same colour
+// component of a 2x2 block of pixels. With SSE2, the rows are
+// summed and the sums of horizontal neighbours (3 bytes
+// apart) are averaged 8 bytes at a time into a buffer, from
+// which the bytes of every other pixel are then picked.
+//
+void downsample_bgr(unsigned char *pSrc, int w, int h, unsigned char *pDest)
+{
+	int x, y;
+	int w2 = w / 2, h2 = h / 2;
+	
+	for (y=0 ; y<h2 ; ++y)
+	{
+		unsigned char *p0 = pSrc + 3*2*y*w;
+		unsigned char *p1 = p0 + 3*w;
+		unsigned char *q = pDest + 3*y*w2;
+		x = 0;
+		
+#ifdef USE_SSE2
+		// Blocks of 64 output pixels, averaging the 384 bytes
+		// of each source row into means[]
+		unsigned char means[384];
+		__m128i zero = _mm_setzero_si128();
+		__m128i two = _mm_set1_epi16(2);
+		for ( ; x+64<=w2 ; x+=64)
+		{
+			unsigned char *a = p0 + 6*x;
+			unsigned char *b = p1 + 6*x;
+			int k;
+			
+			// The last 3 bytes (of the last odd pixel) aren't
+			// needed, so nothing past the block is read
+			for (k=0 ; k+8<=381 ; k+=8)
+			{
+				__m128i s = _mm_add_epi16(
+					_mm_add_epi16(
+						_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(a + k)), zero),
+						_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(b + k)), zero)),
+					_mm_add_epi16(
+						_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(a + k + 3)), zero),
+						_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(b + k + 3)), zero)));
+				s = _mm_srli_epi16(_mm_add_epi16(s, two), 2);
+				_mm_storel_epi64((__m128i *)(means + k), _mm_packus_epi16(s, zero));
+			}
+			for ( ; k<381 ; ++k)
+			{
+				means[k] = (unsigned char)((a[k] + a[k+3] + b[k] + b[k+3] + 2) >> 2);
+			}
+			
+			// Keep the first pixel of each pair, copying 4 bytes
+			// at a time (the 4th is overwritten by the next pixel)
+			unsigned char *m = means;
+			unsigned char *d = q + 3*x;
+			for (k=0 ; k<63 ; ++k, m+=6, d+=3) memcpy(d, m, 4);
+			d[0] = m[0];
+			d[1] = m[1];
+			d[2] = m[2];
+		}
+#endif
+		
+		for ( ; x<w2 ; ++x)
+		{
+			unsigned char *a = p0 + 6*x;
+			unsigned char *b = p1 + 6*x;
+			unsigned char *d = q + 3*x;
+			d[0] = (unsigned char)((a[0] + a[3] + b[0] + b[3] + 2) >> 2);
+			d[1] = (unsigned char)((a[1] + a[4] + b[1] + b[4] + 2) >> 2);
+			d[2] = (unsigned char)((a[2] + a[5] + b[2] + b[5] + 2) >> 2);
+		}
+	}
+}
+
+int level_region(OutputRegion *region, int w, int h,
+	int *rx, int *ry, int *rw, int *rh)
+{
+	int level = region->level;
+	if (level < 0 || level >= MAX_PYRAMID_LEVELS) return 1;
+	
+	w >>= level;
+	h >>= level;
+	*rx = region->x >> level;
+	*ry = region->y >> level;
+	*rw = (region->w > 0) ? region->w >> level : w - *rx;
+	*rh = (region->h > 0) ? region->h >> level : h - *ry;
+	if (*rx + *rw > w) *rw = w - *rx;
+	if (*ry + *rh > h) *rh = h - *ry;
+	
+	return (region->x < 0 || region->y < 0 || *rw <= 0 || *rh <= 0);
+}
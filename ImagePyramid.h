@@ -0,0 +1,72 @@
+//
+// ImagePyramid.h - ImagePyramid header file
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef IMAGEPYRAMID_H
+#define IMAGEPYRAMID_H
+
+#define MAX_PYRAMID_LEVELS 8
+
+// A pyramid of top-down 8-bit grey images (or bottom-up
+// BGR frames), each half the width and height of the one
+// below it (2x2 box filter). All levels are allocated once
+// by init and reused.
+class ImagePyramid
+{
+public:
+	ImagePyramid();
+	~ImagePyramid();
+	
+	// Allocate a pyramid for w x h images with the given
+	// number of levels (level 0 is full size)
+	int init(int w, int h, int number_levels);
+	
+	// Allocate a pyramid for w x h BGR frames. Level 0 is not
+	// copied: it is the frame most recently passed to build.
+	int initBGR(int w, int h, int number_levels);
+	
+	// Copy a grey image into level 0 and rebuild the other levels
+	void build(unsigned char *pGrey);
+	
+	// Rebuild only the first number_levels levels
+	void build(unsigned char *pImage, int number_levels);
+	
+	unsigned char *level(int n);
+	int levelWidth(int n);
+	int levelHeight(int n);
+	int levels();
+	
+private:
+	int num_levels;
+	int widths[MAX_PYRAMID_LEVELS];
+	int heights[MAX_PYRAMID_LEVELS];
+	unsigned char *images[MAX_PYRAMID_LEVELS];
+	int bgr;	// levels are BGR frames and level 0 is not owned
+	
+	int allocate(int w, int h, int number_levels, int bytes_per_pixel);
+};
+
+// Halve a grey image in each direction by averaging 2x2 blocks
+void downsample_grey(unsigned char *pSrc, int w, int h, unsigned char *pDest);
+
+// Halve a bottom-up BGR frame in each direction in the same way
+void downsample_bgr(unsigned char *pSrc, int w, int h, unsigned char *pDest);
+
+// Part of a frame written by an output: a region of
+// interest at one pyramid level. x, y, w and h are full
+// size pixels from the top left of the frame, and a w or h
+// of 0 means the rest of the frame.
+struct OutputRegion
+{
+	int x, y, w, h;
+	int level;
+};
+
+// Find the pixels of a w x h frame's pyramid level covered
+// by a region. Returns 0, or 1 if the region is empty.
+int level_region(OutputRegion *region, int w, int h,
+	int *rx, int *ry, int *rw, int *rh);
+
+#endif // IMAGEPYRAMID_H
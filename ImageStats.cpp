@@ -0,0 +1,204 @@
+//
+// ImageStats.cpp - ImageStats class
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Each row of the frame is read once, while it is in the
+// cache, to update the histogram, the frame hash and the
+// Laplacian sums. The hash is a Fletcher checksum of each
+// row folded into a 64-bit FNV-1a hash, which is enough to
+// tell a frozen camera (identical frames) from a live one,
+// since sensor noise changes every live frame.
+//
+
+#include <string.h>
+
+#include "ImageStats.h"
+#include "Platform.h"
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+// Fill in the exposure statistics of a histogram
+static void histogram_stats(double *hist, StatsResult *result)
+{
+	double total = 0, sum = 0, dark = 0, bright = 0, count;
+	int n;
+	
+	for (n=0 ; n<256 ; ++n)
+	{
+		total += hist[n];
+		sum += n * hist[n];
+		if (n <= STATS_CLIP_LOW) dark += hist[n];
+		if (n >= STATS_CLIP_HIGH) bright += hist[n];
+	}
+	if (total == 0) total = 1;
+	
+	result->mean = sum / total;
+	result->dark = dark / total;
+	result->bright = bright / total;
+	
+	// Percentiles from the cumulative histogram
+	result->p5 = result->p50 = result->p95 = -1;
+	count = 0;
+	for (n=0 ; n<256 ; ++n)
+	{
+		count += hist[n];
+		if (result->p5 < 0 && count >= 0.05 * total) result->p5 = n;
+		if (result->p50 < 0 && count >= 0.5 * total) result->p50 = n;
+		if (result->p95 < 0 && count >= 0.95 * total) result->p95 = n;
+	}
+}
+
+ImageStats::ImageStats()
+{
+	width = height = 0;
+}
+
+void ImageStats::init(int w, int h)
+{
+	width = w;
+	height = h;
+	memset(period_histogram, 0, sizeof(period_histogram));
+	period_focus = 0;
+	period_frames = 0;
+	period_repeats = 0;
+	last_hash = 0;
+	have_last_hash = 0;
+}
+
+void ImageStats::process(unsigned char *pGrey, StatsResult *result)
+{
+	unsigned int counts[4][256];
+	double hist[256];
+	long long laplacian_sum = 0, laplacian_squares = 0;
+	unsigned long long hash = FNV_OFFSET;
+	int x, y, n;
+	int w = width, h = height;
+	
+	memset(counts, 0, sizeof(counts));
+	
+	for (y=0 ; y<h ; ++y)
+	{
+		unsigned char *p = pGrey + y*w;
+		
+		// Histogram, with four sets of counts so that
+		// neighbouring pixels rarely update the same count
+		for (x=0 ; x+4<=w ; x+=4)
+		{
+			counts[0][p[x]]++;
+			counts[1][p[x+1]]++;
+			counts[2][p[x+2]]++;
+			counts[3][p[x+3]]++;
+		}
+		for ( ; x<w ; ++x) counts[0][p[x]]++;
+		
+		// Fletcher checksum of the row: a is the sum of the
+		// pixels and b is the sum of the running values of a
+		unsigned int a = 0, b = 0;
+		x = 0;
+#ifdef USE_SSE2
+		{
+			// For each block of 16 pixels, b grows by 16 times
+			// the previous a plus the pixels weighted 16 to 1
+			__m128i zero = _mm_setzero_si128();
+			__m128i weights_lo = _mm_set_epi16(9, 10, 11, 12, 13, 14, 15, 16);
+			__m128i weights_hi = _mm_set_epi16(1, 2, 3, 4, 5, 6, 7, 8);
+			__m128i va = zero, vprevious = zero, vweighted = zero;
+			for ( ; x+16<=w ; x+=16)
+			{
+				__m128i v = _mm_loadu_si128((__m128i *)(p + x));
+				vprevious = _mm_add_epi64(vprevious, va);
+				va = _mm_add_epi64(va, _mm_sad_epu8(v, zero));
+				vweighted = _mm_add_epi32(vweighted, _mm_add_epi32(
+					_mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weights_lo),
+					_mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weights_hi)));
+			}
+			unsigned int lanes[4];
+			_mm_storeu_si128((__m128i *)lanes, va);
+			a = lanes[0] + lanes[2];
+			_mm_storeu_si128((__m128i *)lanes, vprevious);
+			b = 16 * (lanes[0] + lanes[2]);
+			_mm_storeu_si128((__m128i *)lanes, vweighted);
+			b += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		}
+#endif
+		for ( ; x<w ; ++x)
+		{
+			a += p[x];
+			b += a;
+		}
+		hash = (hash ^ a) * FNV_PRIME;
+		hash = (hash ^ b) * FNV_PRIME;
+		
+		// Laplacian (4 times the pixel minus its four
+		// neighbours) at every pixel away from the border
+		if (y == 0 || y == h-1) continue;
+		x = 1;
+#ifdef USE_SSE2
+		{
+			__m128i zero = _mm_setzero_si128();
+			__m128i ones = _mm_set1_epi16(1);
+			__m128i vsum = zero, vsquares = zero;
+			for ( ; x+8<=w-1 ; x+=8)
+			{
+				__m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(p + x)), zero);
+				__m128i l = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(p + x - 1)), zero);
+				__m128i r = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(p + x + 1)), zero);
+				__m128i u = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(p + x - w)), zero);
+				__m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(p + x + w)), zero);
+				__m128i lap = _mm_sub_epi16(_mm_slli_epi16(c, 2),
+					_mm_add_epi16(_mm_add_epi16(l, r), _mm_add_epi16(u, d)));
+				vsum = _mm_add_epi32(vsum, _mm_madd_epi16(lap, ones));
+				vsquares = _mm_add_epi32(vsquares, _mm_madd_epi16(lap, lap));
+			}
+			int lanes[4];
+			_mm_storeu_si128((__m128i *)lanes, vsum);
+			laplacian_sum += (long long)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+			_mm_storeu_si128((__m128i *)lanes, vsquares);
+			laplacian_squares += (long long)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		}
+#endif
+		for ( ; x<w-1 ; ++x)
+		{
+			int lap = 4*p[x] - p[x-1] - p[x+1] - p[x-w] - p[x+w];
+			laplacian_sum += lap;
+			laplacian_squares += lap * lap;
+		}
+	}
+	
+	for (n=0 ; n<256 ; ++n)
+	{
+		histogram[n] = counts[0][n] + counts[1][n] + counts[2][n] + counts[3][n];
+		hist[n] = histogram[n];
+		period_histogram[n] += hist[n];
+	}
+	histogram_stats(hist, result);
+	
+	double count = (double)(w - 2) * (h - 2);
+	double mean = laplacian_sum / count;
+	result->focus = laplacian_squares / count - mean * mean;
+	result->hash = (unsigned int)(hash ^ (hash >> 32));
+	result->repeats = have_last_hash && result->hash == last_hash;
+	result->frames = 1;
+	
+	period_focus += result->focus;
+	period_repeats += result->repeats;
+	period_frames++;
+	last_hash = result->hash;
+	have_last_hash = 1;
+}
+
+void ImageStats::summary(StatsResult *result)
+{
+	histogram_stats(period_histogram, result);
+	result->focus = period_frames ? period_focus / period_frames : 0;
+	result->hash = last_hash;
+	result->repeats = period_repeats;
+	result->frames = period_frames;
+	
+	memset(period_histogram, 0, sizeof(period_histogram));
+	period_focus = 0;
+	period_frames = 0;
+	period_repeats = 0;
+}
@@ -0,0 +1,59 @@
+//
+// ImageStats.h - ImageStats header file
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef IMAGESTATS_H
+#define IMAGESTATS_H
+
+// Grey levels counted as clipped at the dark and bright ends
+#define STATS_CLIP_LOW 4
+#define STATS_CLIP_HIGH 251
+
+#define STATS_FRAME 1	// one record per frame
+#define STATS_PERIOD 2	// one record per capture period
+
+// Statistics for one frame or for all frames in a period
+struct StatsResult
+{
+	int frames;	// number of frames included
+	double mean;	// mean grey level
+	int p5, p50, p95;	// 5th, 50th and 95th percentile grey levels
+	double focus;	// variance of the Laplacian (higher is sharper)
+	double dark;	// fraction of pixels at or below STATS_CLIP_LOW
+	double bright;	// fraction of pixels at or above STATS_CLIP_HIGH
+	unsigned int hash;	// hash of the (last) frame
+	int repeats;	// frames identical to the frame before them
+};
+
+// Measures exposure, focus and change of top-down grey
+// frames in a single pass over each frame. Totals are kept
+// so that the frames of a whole period can be summarised.
+class ImageStats
+{
+public:
+	ImageStats();
+	
+	void init(int w, int h);
+	
+	// Measure one frame, add it to the period totals and
+	// return its own statistics
+	void process(unsigned char *pGrey, StatsResult *result);
+	
+	// Return the statistics of all frames since the last
+	// summary and start a new period
+	void summary(StatsResult *result);
+	
+private:
+	int width, height;
+	unsigned int histogram[256];	// histogram of the last frame
+	double period_histogram[256];	// histogram of the period so far
+	double period_focus;
+	int period_frames;
+	int period_repeats;
+	unsigned int last_hash;
+	int have_last_hash;
+};
+
+#endif // IMAGESTATS_H
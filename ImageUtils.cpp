@@ -0,0 +1,279 @@
+//
+// ImageUtils.cpp - Image helper functions used by the processing stages
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ImageUtils.h"
+
+// Size of the file and info headers of a BMP file
+#define BMP_HEADER_SIZE 54
+
+// Little-endian values in BMP headers
+static void put_16(unsigned char *p, int value)
+{
+	p[0] = value & 0xff;
+	p[1] = (value >> 8) & 0xff;
+}
+
+static void put_32(unsigned char *p, int value)
+{
+	put_16(p, value & 0xffff);
+	put_16(p + 2, (value >> 16) & 0xffff);
+}
+
+static int get_16(unsigned char *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static int get_32(unsigned char *p)
+{
+	return get_16(p) | (get_16(p + 2) << 16);
+}
+
+// Read the next number from a PGM header, skipping
+// whitespace and comments. Returns -1 on failure.
+static int read_pgm_number(FILE *f)
+{
+	int c, value;
+	
+	while ((c = fgetc(f)) != EOF)
+	{
+		if (c == '#')
+		{
+			while ((c = fgetc(f)) != EOF && c != '\n');
+		}
+		else if (c != ' ' && c != '\t' && c != '\r' && c != '\n') break;
+	}
+	if (c == EOF) return -1;
+	ungetc(c, f);
+	if (fscanf(f, "%d", &value) != 1) return -1;
+	return value;
+}
+
+// Open an image file and read its header. type is set to
+// 2 or 5 for PGM files and 24 for BMP files. For BMP files,
+// h is negative if the rows are stored top-down.
+static FILE *open_image(char *filename, int *type, int *w, int *h)
+{
+	unsigned char header[BMP_HEADER_SIZE];
+	FILE *f = fopen(filename, "rb");
+	if (f == NULL) return NULL;
+	
+	memset(header, 0, sizeof(header));
+	if (fread(header, 1, 2, f) == 2 && header[0] == 'P' &&
+		(header[1] == '2' || header[1] == '5'))
+	{
+		*type = header[1] - '0';
+		*w = read_pgm_number(f);
+		*h = read_pgm_number(f);
+		if (*w > 0 && *h > 0 && read_pgm_number(f) == 255)
+		{
+			fgetc(f); // single whitespace character before the pixels
+			return f;
+		}
+	}
+	else if (header[0] == 'B' && header[1] == 'M' &&
+		fread(header + 2, 1, BMP_HEADER_SIZE - 2, f) == BMP_HEADER_SIZE - 2 &&
+		get_16(header + 28) == 24 && get_32(header + 30) == 0)
+	{
+		*type = 24;
+		*w = get_32(header + 18);
+		*h = get_32(header + 22);
+		if (*w > 0 && *h != 0 && fseek(f, get_32(header + 10), SEEK_SET) == 0) return f;
+	}
+	
+	fclose(f);
+	return NULL;
+}
+
+void bgr_to_grey(unsigned char *pBuf, unsigned char *pGrey, int w, int h)
+{
+	int x, y;
+	unsigned char *p, *q;
+	
+	for (y=0 ; y<h ; ++y)
+	{
+		p = pBuf + 3*(h-1-y)*w;
+		q = pGrey + y*w;
+		
+		// (sum * 21846) >> 16 is exactly sum/3 for 0 <= sum <= 765
+		for (x=0 ; x<w ; ++x, p+=3)
+		{
+			q[x] = (unsigned char)(((p[0] + p[1] + p[2]) * 21846) >> 16);
+		}
+	}
+}
+
+int write_pgm_file(char *filename, unsigned char *pBuf, int w, int h)
+{
+	int val, n;
+	
+	FILE *f;
+	if ((f = fopen(filename, "w")))
+	{
+		// Write current frame to PGM file
+		fprintf(f, "P2\n# Frame captured by RobotEyez\n%d %d\n255\n", w, h);
+		for (int y=h-1 ; y>=0 ; --y)
+		{
+			for (int x=0 ; x<w ; ++x)
+			{
+				n = 3*(y*w + x);
+				val = (pBuf[n] + pBuf[n+1] + pBuf[n+2]) / 3;
+				fprintf(f, "%d ", val);
+			}
+			fprintf(f, "\n");
+		}
+		fclose(f);
+	}
+	
+	return 0;
+}
+
+int write_bmp_file(char *filename, unsigned char *pBuf, int w, int h)
+{
+	// BITMAPFILEHEADER followed by BITMAPINFOHEADER, written
+	// byte by byte so that windows.h is not needed
+	unsigned char header[BMP_HEADER_SIZE];
+	memset(header, 0, sizeof(header));
+	header[0] = 'B';
+	header[1] = 'M';
+	int padding = (4 - (3*w) % 4) % 4;	// rows are padded to a multiple of 4 bytes
+	put_32(header + 2, BMP_HEADER_SIZE + (3*w + padding)*h);	// bfSize
+	put_32(header + 10, BMP_HEADER_SIZE);	// bfOffBits
+	put_32(header + 14, 40);	// biSize
+	put_32(header + 18, w);	// biWidth
+	put_32(header + 22, h);	// biHeight
+	put_16(header + 26, 1);	// biPlanes
+	put_16(header + 28, 24);	// biBitCount (biCompression = BI_RGB = 0)
+	put_32(header + 38, 3780);	// biXPelsPerMeter (96dpi equivalent)
+	put_32(header + 42, 3780);	// biYPelsPerMeter
+	
+	// Open bitmap file (binary mode)
+	FILE *f;
+	f = fopen(filename, "wb");
+	if (f == NULL) return 1;
+	
+	// Write bitmap header and pixel data starting with
+	// the bottom line of pixels, left hand side
+	fwrite(header, 1, sizeof(header), f);
+	if (padding == 0)
+	{
+		fwrite(pBuf, 1, 3*w*h, f);
+	}
+	else
+	{
+		unsigned char zeros[3] = {0, 0, 0};
+		for (int y=0 ; y<h ; ++y)
+		{
+			fwrite(pBuf + 3*y*w, 1, 3*w, f);
+			fwrite(zeros, 1, padding, f);
+		}
+	}
+	
+	// Close bitmap file
+	fclose(f);
+	
+	return 0;
+}
+
+void crop_frame(unsigned char *pSrc, int w, int h,
+	int x, int y, int cw, int ch, unsigned char *pDest)
+{
+	// The region's bottom row is row h-y-ch of the
+	// bottom-up source frame
+	unsigned char *p = pSrc + 3*((h - y - ch)*w + x);
+	
+	if (cw == w)
+	{
+		memcpy(pDest, p, 3*w*ch);
+		return;
+	}
+	for (int row=0 ; row<ch ; ++row)
+	{
+		memcpy(pDest + 3*row*cw, p + 3*row*w, 3*cw);
+	}
+}
+
+int read_image_size(char *filename, int *w, int *h)
+{
+	int type;
+	FILE *f = open_image(filename, &type, w, h);
+	if (f == NULL) return 1;
+	fclose(f);
+	if (*h < 0) *h = -*h;
+	return 0;
+}
+
+int read_frame_file(char *filename, unsigned char *pBuf, int w, int h)
+{
+	int type, file_w, file_h, x, y, value, ok = 1;
+	FILE *f = open_image(filename, &type, &file_w, &file_h);
+	if (f == NULL) return 1;
+	
+	if (type == 24)
+	{
+		// BMP rows are padded to a multiple of 4 bytes and
+		// are stored bottom-up unless the height is negative
+		int top_down = file_h < 0;
+		if (top_down) file_h = -file_h;
+		int padding = (4 - (3*w) % 4) % 4;
+		if (file_w != w || file_h != h) ok = 0;
+		for (y=0 ; ok && y<h ; ++y)
+		{
+			unsigned char *p = pBuf + 3*w*(top_down ? h-1-y : y);
+			if (fread(p, 1, 3*w, f) != (size_t)(3*w)) ok = 0;
+			if (padding) fseek(f, padding, SEEK_CUR);
+		}
+	}
+	else
+	{
+		// PGM rows are stored top-down
+		if (file_w != w || file_h != h) ok = 0;
+		for (y=0 ; ok && y<h ; ++y)
+		{
+			unsigned char *p = pBuf + 3*w*(h-1-y);
+			for (x=0 ; x<w ; ++x, p+=3)
+			{
+				value = (type == 5) ? fgetc(f) : read_pgm_number(f);
+				if (value < 0) { ok = 0; break; }
+				p[0] = p[1] = p[2] = (unsigned char)value;
+			}
+		}
+	}
+	
+	fclose(f);
+	return ok ? 0 : 1;
+}
+
+int write_grey_pgm_file(char *filename, unsigned char *pGrey, int w, int h)
+{
+	FILE *f;
+	
+	f = fopen(filename, "wb");
+	if (f == NULL) return 1;
+	
+	fprintf(f, "P5\n# Image saved by RobotEyez\n%d %d\n255\n", w, h);
+	fwrite(pGrey, 1, w*h, f);
+	fclose(f);
+	
+	return 0;
+}
+
+void make_extra_filename(char *dest, char *filename, const char *suffix)
+{
+	int n;
+	char *dot = strrchr(filename, '.');
+	
+	// Copy everything before the file extension, then
+	// append the suffix and a PGM extension
+	n = (dot != NULL) ? (int)(dot - filename) : (int)strlen(filename);
+	strncpy(dest, filename, n);
+	dest[n] = '\0';
+	strcat(dest, suffix);
+	strcat(dest, ".pgm");
+}
@@ -0,0 +1,42 @@
+//
+// ImageUtils.h - Image helper functions used by the processing stages
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef IMAGEUTILS_H
+#define IMAGEUTILS_H
+
+// Convert a bottom-up BGR24 frame (as delivered by DirectShow)
+// into a top-down 8-bit grey image. The grey level of each
+// pixel is (b+g+r)/3, the same as in the PGM files.
+void bgr_to_grey(unsigned char *pBuf, unsigned char *pGrey, int w, int h);
+
+// Write a bottom-up BGR24 frame to an ASCII (P2) PGM file
+// or to a 24-bit BMP file
+int write_pgm_file(char *filename, unsigned char *pBuf, int w, int h);
+int write_bmp_file(char *filename, unsigned char *pBuf, int w, int h);
+
+// Copy the cw x ch region at (x, y) from the top left of
+// a bottom-up BGR24 frame into a bottom-up BGR24 frame
+void crop_frame(unsigned char *pSrc, int w, int h,
+	int x, int y, int cw, int ch, unsigned char *pDest);
+
+// Find the size of an image in a PGM (P2 or P5) or 24-bit
+// BMP file. Returns 0 on success or 1 if it can't be read.
+int read_image_size(char *filename, int *w, int *h);
+
+// Read a PGM or 24-bit BMP file of size w x h into a
+// bottom-up BGR24 frame (grey images have b = g = r).
+// Returns 0 on success or 1 if it can't be read.
+int read_frame_file(char *filename, unsigned char *pBuf, int w, int h);
+
+// Write a top-down 8-bit grey image to a binary (P5) PGM file.
+// Returns 0 on success or 1 if the file could not be opened.
+int write_grey_pgm_file(char *filename, unsigned char *pGrey, int w, int h);
+
+// Build a filename for an extra image saved alongside a frame,
+// e.g. "frame0001.bmp" + "_fg" -> "frame0001_fg.pgm"
+void make_extra_filename(char *dest, char *filename, const char *suffix);
+
+#endif // IMAGEUTILS_H
@@ -0,0 +1,649 @@
+//
+// MarkerDetector.cpp - MarkerDetector class
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Markers are found in four steps. The half size image is
+// thresholded against the local mean (from an integral
+// image) and its dark pixels grouped into 8-connected
+// components. The outer contour of each component is traced
+// and accepted if it is close to a quadrilateral. The sides
+// of the quadrilateral are then located to sub-pixel accuracy
+// on the full size image, and finally the 7x7 cells inside
+// it are sampled through the perspective mapping of the
+// refined corners and looked up in the ArUco dictionary.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "MarkerDetector.h"
+#include "ImagePyramid.h"
+
+// Contour tracing directions, clockwise from east (y is down)
+static const int dir_x[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+static const int dir_y[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+// Each row of the original ArUco marker holds one of these
+// 5-bit codewords, which encode 2 bits of the id. Any two of
+// them differ in at least 3 bits, so one wrong bit per row
+// can be corrected.
+static const int row_codes[4] = {0x10, 0x17, 0x09, 0x0e};
+
+static int find_root(int *parent, int l)
+{
+	while (parent[l] != l)
+	{
+		parent[l] = parent[parent[l]];
+		l = parent[l];
+	}
+	return l;
+}
+
+// Merge the components with labels a and b (a may be -1)
+// and return the label of the merged component. The root
+// of every component is always its lowest label.
+static int merge_labels(int *parent, int a, int b)
+{
+	b = find_root(parent, b);
+	if (a < 0) return b;
+	a = find_root(parent, a);
+	if (a < b) { parent[b] = a; return a; }
+	parent[a] = b;
+	return b;
+}
+
+// Bilinear sample of a grey image at (x,y)
+static float sample_grey(unsigned char *pGrey, int w, float x, float y)
+{
+	int ix = (int)x, iy = (int)y;
+	float fx = x - ix, fy = y - iy;
+	unsigned char *p = pGrey + iy*w + ix;
+	float top = p[0] + fx * (p[1] - p[0]);
+	float bottom = p[w] + fx * (p[w+1] - p[w]);
+	return top + fy * (bottom - top);
+}
+
+// Number of bits set in a 5-bit value
+static int count_bits(int n)
+{
+	int count = 0;
+	for ( ; n ; n >>= 1) count += n & 1;
+	return count;
+}
+
+MarkerDetector::MarkerDetector()
+{
+	width = height = 0;
+	half = NULL;
+	integral = NULL;
+	binary = NULL;
+	labels = NULL;
+	parent = NULL;
+	first_pixel = NULL;
+	box = NULL;
+	contour_x = contour_y = NULL;
+	num_markers = 0;
+}
+
+MarkerDetector::~MarkerDetector()
+{
+	delete [] half;
+	delete [] integral;
+	delete [] binary;
+	delete [] labels;
+	delete [] parent;
+	delete [] first_pixel;
+	delete [] box;
+	delete [] contour_x;
+	delete [] contour_y;
+}
+
+int MarkerDetector::init(int w, int h)
+{
+	if (w < 4*MARKER_MIN_SIDE || h < 4*MARKER_MIN_SIDE) return 1;
+	
+	width = w;
+	height = h;
+	half_width = w / 2;
+	half_height = h / 2;
+	int half_size = half_width * half_height;
+	
+	// No two pixels that start a new component are 8-connected,
+	// so there can be at most one per 2x2 block
+	int max_labels = ((half_width+1)/2) * ((half_height+1)/2);
+	
+	half = new unsigned char[half_size];
+	integral = new unsigned int[(half_width+1) * (half_height+1)];
+	binary = new unsigned char[half_size];
+	labels = new int[half_size];
+	parent = new int[max_labels];
+	first_pixel = new int[max_labels];
+	box = new int[4*max_labels];
+	max_contour = 4 * (half_width + half_height);
+	contour_x = new int[max_contour];
+	contour_y = new int[max_contour];
+	num_markers = 0;
+	
+	return 0;
+}
+
+int MarkerDetector::process(unsigned char *pGrey)
+{
+	float qx[4], qy[4];
+	Marker marker;
+	int n, k;
+	
+	num_markers = 0;
+	
+	// Search the half size image for dark quadrilaterals
+	downsample_grey(pGrey, width, height, half);
+	threshold();
+	int number_labels = label();
+	
+	for (n=0 ; n<number_labels && num_markers<MAX_MARKERS ; ++n)
+	{
+		if (parent[n] != n) continue;
+		
+		// Skip components that are too small or that are
+		// cut off by the edge of the image
+		int *b = box + 4*n;
+		if (b[2] - b[0] < MARKER_MIN_SIDE || b[3] - b[1] < MARKER_MIN_SIDE) continue;
+		if (b[0] == 0 || b[1] == 0 || b[2] == half_width-1 || b[3] == half_height-1) continue;
+		
+		int length = traceContour(first_pixel[n], n);
+		if (length == 0) continue;
+		if (!fitQuad(length, qx, qy)) continue;
+		
+		// Move the corners onto the full size image. The
+		// contour runs through the centres of the outermost
+		// dark pixels, so push each corner out by about half
+		// a pixel of the half size image.
+		float cx = 0.25f * (qx[0] + qx[1] + qx[2] + qx[3]);
+		float cy = 0.25f * (qy[0] + qy[1] + qy[2] + qy[3]);
+		for (k=0 ; k<4 ; ++k)
+		{
+			float dx = qx[k] - cx, dy = qy[k] - cy;
+			float scale = 0.7f / sqrtf(dx*dx + dy*dy);
+			qx[k] = 2.0f * (qx[k] + scale*dx) + 0.5f;
+			qy[k] = 2.0f * (qy[k] + scale*dy) + 0.5f;
+		}
+		
+		refineCorners(pGrey, qx, qy);
+		if (!decode(pGrey, qx, qy, &marker)) continue;
+		
+		// A marker can only appear once per frame
+		for (k=0 ; k<num_markers ; ++k)
+		{
+			if (marker_list[k].id == marker.id) break;
+		}
+		if (k < num_markers) continue;
+		
+		marker_list[num_markers++] = marker;
+	}
+	
+	return num_markers;
+}
+
+Marker *MarkerDetector::markers()
+{
+	return marker_list;
+}
+
+int MarkerDetector::numMarkers()
+{
+	return num_markers;
+}
+
+//
+// Mark each pixel of the half size image that is darker
+// than the mean of the square around it
+//
+void MarkerDetector::threshold()
+{
+	int x, y;
+	int w = half_width, h = half_height;
+	int stride = w + 1;
+	
+	// Integral image with an extra row and column of zeros
+	memset(integral, 0, stride * sizeof(unsigned int));
+	for (y=0 ; y<h ; ++y)
+	{
+		unsigned int row_sum = 0;
+		unsigned int *above = integral + y*stride;
+		unsigned int *row = above + stride;
+		unsigned char *p = half + y*w;
+		row[0] = 0;
+		for (x=0 ; x<w ; ++x)
+		{
+			row_sum += p[x];
+			row[x+1] = above[x+1] + row_sum;
+		}
+	}
+	
+	for (y=0 ; y<h ; ++y)
+	{
+		int y0 = y - MARKER_THRESHOLD_RADIUS;
+		int y1 = y + MARKER_THRESHOLD_RADIUS + 1;
+		if (y0 < 0) y0 = 0;
+		if (y1 > h) y1 = h;
+		unsigned int *top = integral + y0*stride;
+		unsigned int *bottom = integral + y1*stride;
+		unsigned char *p = half + y*w;
+		unsigned char *q = binary + y*w;
+		
+		for (x=0 ; x<w ; ++x)
+		{
+			int x0 = x - MARKER_THRESHOLD_RADIUS;
+			int x1 = x + MARKER_THRESHOLD_RADIUS + 1;
+			if (x0 < 0) x0 = 0;
+			if (x1 > w) x1 = w;
+			unsigned int sum = bottom[x1] - bottom[x0] - top[x1] + top[x0];
+			unsigned int count = (x1 - x0) * (y1 - y0);
+			q[x] = (p[x] + MARKER_THRESHOLD_OFFSET) * count < sum;
+		}
+	}
+}
+
+//
+// Group the dark pixels into 8-connected components. Each
+// component's root label, first pixel and bounding box are
+// recorded. Returns the number of labels used.
+//
+int MarkerDetector::label()
+{
+	int x, y, i;
+	int w = half_width, h = half_height;
+	int number_labels = 0;
+	
+	// First pass: give each dark pixel the label of a dark
+	// neighbour above or to its left, merging labels where
+	// two components meet
+	for (y=0 ; y<h ; ++y)
+	{
+		for (x=0 ; x<w ; ++x)
+		{
+			i = y*w + x;
+			if (!binary[i]) continue;
+			
+			int l = -1;
+			if (x > 0 && binary[i-1]) l = merge_labels(parent, l, labels[i-1]);
+			if (y > 0)
+			{
+				if (x > 0 && binary[i-w-1]) l = merge_labels(parent, l, labels[i-w-1]);
+				if (binary[i-w]) l = merge_labels(parent, l, labels[i-w]);
+				if (x < w-1 && binary[i-w+1]) l = merge_labels(parent, l, labels[i-w+1]);
+			}
+			if (l < 0)
+			{
+				// This is the first pixel of a new component
+				l = number_labels++;
+				parent[l] = l;
+				first_pixel[l] = i;
+				box[4*l] = box[4*l+2] = x;
+				box[4*l+1] = box[4*l+3] = y;
+			}
+			labels[i] = l;
+		}
+	}
+	
+	// Second pass: replace each label with its root and
+	// grow the root's bounding box
+	for (y=0 ; y<h ; ++y)
+	{
+		for (x=0 ; x<w ; ++x)
+		{
+			i = y*w + x;
+			if (!binary[i]) continue;
+			
+			int l = find_root(parent, labels[i]);
+			labels[i] = l;
+			int *b = box + 4*l;
+			if (x < b[0]) b[0] = x;
+			if (x > b[2]) b[2] = x;
+			if (y > b[3]) b[3] = y;
+		}
+	}
+	
+	return number_labels;
+}
+
+//
+// Trace the outer contour of a component clockwise, starting
+// from its first pixel. Returns the number of contour points,
+// or 0 if the contour is too long.
+//
+int MarkerDetector::traceContour(int start, int component)
+{
+	int x = start % half_width, y = start / half_width;
+	int start_x = x, start_y = y;
+	int dir = 7, first_dir = -1;
+	int length = 0;
+	int k, d, nx, ny;
+	
+	while(1)
+	{
+		// Search clockwise for the next contour pixel, starting
+		// from the outside of the last step
+		int search = (dir + 7 - (dir & 1)) % 8;
+		for (k=0 ; k<8 ; ++k)
+		{
+			d = (search + k) % 8;
+			nx = x + dir_x[d];
+			ny = y + dir_y[d];
+			if (nx >= 0 && nx < half_width && ny >= 0 && ny < half_height &&
+				binary[ny*half_width + nx] && labels[ny*half_width + nx] == component) break;
+		}
+		if (k == 8) return 0; // isolated pixel
+		
+		// Stop on leaving the start pixel the same way again
+		if (x == start_x && y == start_y && d == first_dir) break;
+		if (first_dir < 0) first_dir = d;
+		
+		if (length == max_contour) return 0;
+		contour_x[length] = x;
+		contour_y[length] = y;
+		++length;
+		
+		x = nx;
+		y = ny;
+		dir = d;
+	}
+	
+	return length;
+}
+
+//
+// Fit a quadrilateral to the current contour. Returns 1 and
+// the corners (clockwise) if every contour point lies close
+// to its sides, otherwise 0.
+//
+int MarkerDetector::fitQuad(int length, float *qx, float *qy)
+{
+	int i, k, dx, dy, d, best;
+	int corner[4];
+	
+	if (length < 4*MARKER_MIN_SIDE) return 0;
+	
+	// The first corner is the point furthest from the start
+	// of the contour and the opposite corner is the point
+	// furthest from that
+	for (k=0 ; k<2 ; ++k)
+	{
+		int from = k ? corner[0] : 0;
+		best = -1;
+		for (i=0 ; i<length ; ++i)
+		{
+			dx = contour_x[i] - contour_x[from];
+			dy = contour_y[i] - contour_y[from];
+			d = dx*dx + dy*dy;
+			if (d > best) { best = d; corner[2*k] = i; }
+		}
+	}
+	
+	// The other two corners are the points furthest from
+	// the diagonal on each side of it
+	int x0 = contour_x[corner[0]], y0 = contour_y[corner[0]];
+	dx = contour_x[corner[2]] - x0;
+	dy = contour_y[corner[2]] - y0;
+	int best1 = 0, best3 = 0;
+	corner[1] = corner[3] = -1;
+	for (i=0 ; i<length ; ++i)
+	{
+		d = dx * (contour_y[i] - y0) - dy * (contour_x[i] - x0);
+		if (d > best1) { best1 = d; corner[1] = i; }
+		if (-d > best3) { best3 = -d; corner[3] = i; }
+	}
+	if (corner[1] < 0 || corner[3] < 0) return 0;
+	
+	// Put the corners in contour order
+	int order[4] = {corner[0], corner[1], corner[2], corner[3]};
+	for (k=1 ; k<4 ; ++k)
+	{
+		for (i=k ; i>0 && order[i] < order[i-1] ; --i)
+		{
+			int t = order[i]; order[i] = order[i-1]; order[i-1] = t;
+		}
+	}
+	
+	// Each side must be long enough and the contour between
+	// its corners must stay close to it
+	for (k=0 ; k<4 ; ++k)
+	{
+		int a = order[k], b = order[(k+1)%4];
+		int ax = contour_x[a], ay = contour_y[a];
+		int sx = contour_x[b] - ax, sy = contour_y[b] - ay;
+		float side = sqrtf((float)(sx*sx + sy*sy));
+		if (side < MARKER_MIN_SIDE) return 0;
+		float limit = (1.5f + 0.05f*side) * side;
+		
+		for (i=a ; i!=b ; i=(i+1)%length)
+		{
+			d = sx * (contour_y[i] - ay) - sy * (contour_x[i] - ax);
+			if (abs(d) > limit) return 0;
+		}
+		
+		qx[k] = (float)ax;
+		qy[k] = (float)ay;
+	}
+	
+	// The quadrilateral must be convex and, since the contour
+	// was traced clockwise, turn the same way at every corner
+	for (k=0 ; k<4 ; ++k)
+	{
+		float ax = qx[(k+1)%4] - qx[k], ay = qy[(k+1)%4] - qy[k];
+		float bx = qx[(k+2)%4] - qx[(k+1)%4], by = qy[(k+2)%4] - qy[(k+1)%4];
+		if (ax*by - ay*bx <= 0) return 0;
+	}
+	
+	return 1;
+}
+
+//
+// Move each side of the quadrilateral onto the strongest
+// dark to light edge just outside it, then recalculate the
+// corners as the intersections of the sides. The corners
+// are left unchanged if any side cannot be found.
+//
+void MarkerDetector::refineCorners(unsigned char *pGrey, float *qx, float *qy)
+{
+	float line_x[4], line_y[4], line_dx[4], line_dy[4];
+	float profile[7];
+	float new_x[4], new_y[4];
+	int k, n, o;
+	
+	for (k=0 ; k<4 ; ++k)
+	{
+		float sx = qx[(k+1)%4] - qx[k], sy = qy[(k+1)%4] - qy[k];
+		float side = sqrtf(sx*sx + sy*sy);
+		float nx = sy / side, ny = -sx / side; // outward normal
+		int samples = (int)(side / 2);
+		if (samples > 16) samples = 16;
+		
+		// Find the edge along the normal at points spread
+		// along the side (staying clear of the corners)
+		float sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0, sum_yy = 0;
+		int count = 0;
+		for (n=0 ; n<samples ; ++n)
+		{
+			float t = 0.15f + 0.7f * (n + 0.5f) / samples;
+			float px = qx[k] + t*sx, py = qy[k] + t*sy;
+			
+			for (o=0 ; o<7 ; ++o)
+			{
+				float x = px + (o-3)*nx, y = py + (o-3)*ny;
+				if (x < 0 || y < 0 || x >= width-1 || y >= height-1) break;
+				profile[o] = sample_grey(pGrey, width, x, y);
+			}
+			if (o < 7) continue;
+			
+			// Strongest increase in brightness going outwards,
+			// located to sub-pixel accuracy with a parabola
+			float g[7];
+			int peak = 0;
+			for (o=1 ; o<6 ; ++o)
+			{
+				g[o] = profile[o+1] - profile[o-1];
+				if (peak == 0 || g[o] > g[peak]) peak = o;
+			}
+			if (g[peak] < MARKER_MIN_CONTRAST || peak == 1 || peak == 5) continue;
+			float curvature = g[peak-1] - 2*g[peak] + g[peak+1];
+			float offset = peak - 3;
+			if (curvature < 0) offset += 0.5f * (g[peak-1] - g[peak+1]) / curvature;
+			
+			float ex = px + offset*nx, ey = py + offset*ny;
+			sum_x += ex; sum_y += ey;
+			sum_xx += ex*ex; sum_xy += ex*ey; sum_yy += ey*ey;
+			++count;
+		}
+		if (count < 3 || 2*count < samples) return;
+		
+		// Least squares line through the edge points
+		float mx = sum_x / count, my = sum_y / count;
+		float cxx = sum_xx/count - mx*mx;
+		float cxy = sum_xy/count - mx*my;
+		float cyy = sum_yy/count - my*my;
+		float angle = 0.5f * atan2f(2*cxy, cxx - cyy);
+		line_x[k] = mx;
+		line_y[k] = my;
+		line_dx[k] = cosf(angle);
+		line_dy[k] = sinf(angle);
+	}
+	
+	// Each corner is where the sides before and after it meet
+	for (k=0 ; k<4 ; ++k)
+	{
+		int a = (k+3) % 4, b = k;
+		float det = line_dx[a]*line_dy[b] - line_dy[a]*line_dx[b];
+		if (fabsf(det) < 0.1f) return;
+		float t = ((line_x[b]-line_x[a])*line_dy[b] - (line_y[b]-line_y[a])*line_dx[b]) / det;
+		new_x[k] = line_x[a] + t*line_dx[a];
+		new_y[k] = line_y[a] + t*line_dy[a];
+		
+		float dx = new_x[k] - qx[k], dy = new_y[k] - qy[k];
+		if (dx*dx + dy*dy > 16) return;
+	}
+	
+	for (k=0 ; k<4 ; ++k)
+	{
+		qx[k] = new_x[k];
+		qy[k] = new_y[k];
+	}
+}
+
+//
+// Sample the 7x7 cells of a candidate marker and look up
+// its id. Returns 1 and fills in the marker if the border
+// is black and the bits decode in exactly one orientation.
+//
+int MarkerDetector::decode(unsigned char *pGrey, float *qx, float *qy, Marker *marker)
+{
+	static const float offsets[5][2] = {{0,0}, {-0.2f,-0.2f}, {0.2f,-0.2f}, {-0.2f,0.2f}, {0.2f,0.2f}};
+	float cells[7][7];
+	int bits[5][5], rotated[5][5];
+	int x, y, k, r;
+	
+	// Perspective mapping of the unit square onto the
+	// corners (Heckbert's square to quadrilateral mapping)
+	float sx = qx[0] - qx[1] + qx[2] - qx[3];
+	float sy = qy[0] - qy[1] + qy[2] - qy[3];
+	float dx1 = qx[1] - qx[2], dx2 = qx[3] - qx[2];
+	float dy1 = qy[1] - qy[2], dy2 = qy[3] - qy[2];
+	float den = dx1*dy2 - dx2*dy1;
+	if (fabsf(den) < 1e-6f) return 0;
+	float g = (sx*dy2 - dx2*sy) / den;
+	float h = (dx1*sy - sx*dy1) / den;
+	float a = qx[1] - qx[0] + g*qx[1], b = qx[3] - qx[0] + h*qx[3], c = qx[0];
+	float d = qy[1] - qy[0] + g*qy[1], e = qy[3] - qy[0] + h*qy[3], f = qy[0];
+	
+	// Mean brightness near the centre of each cell
+	float darkest = 255, brightest = 0;
+	for (y=0 ; y<7 ; ++y)
+	{
+		for (x=0 ; x<7 ; ++x)
+		{
+			float sum = 0;
+			for (k=0 ; k<5 ; ++k)
+			{
+				float u = (x + 0.5f + offsets[k][0]) / 7;
+				float v = (y + 0.5f + offsets[k][1]) / 7;
+				float w = g*u + h*v + 1;
+				int px = (int)((a*u + b*v + c) / w + 0.5f);
+				int py = (int)((d*u + e*v + f) / w + 0.5f);
+				if (px < 0 || py < 0 || px >= width || py >= height) return 0;
+				sum += pGrey[py*width + px];
+			}
+			cells[y][x] = sum / 5;
+			if (cells[y][x] < darkest) darkest = cells[y][x];
+			if (cells[y][x] > brightest) brightest = cells[y][x];
+		}
+	}
+	if (brightest - darkest < MARKER_MIN_CONTRAST) return 0;
+	float threshold = 0.5f * (darkest + brightest);
+	
+	// The border cells must all be black
+	for (k=0 ; k<7 ; ++k)
+	{
+		if (cells[0][k] >= threshold || cells[6][k] >= threshold) return 0;
+		if (cells[k][0] >= threshold || cells[k][6] >= threshold) return 0;
+	}
+	
+	// White cells are 1 bits
+	for (y=0 ; y<5 ; ++y)
+	{
+		for (x=0 ; x<5 ; ++x) bits[y][x] = cells[y+1][x+1] >= threshold;
+	}
+	
+	// Try each orientation, turning the bits anticlockwise
+	// a quarter turn at a time, and keep the one with fewest
+	// corrected bits
+	int best_errors = MARKER_MAX_ERRORS + 1, best_rotation = -1, best_id = 0;
+	int ambiguous = 0;
+	for (r=0 ; r<4 ; ++r)
+	{
+		int errors = 0, id = 0;
+		for (y=0 ; y<5 ; ++y)
+		{
+			int row = 0;
+			for (x=0 ; x<5 ; ++x) row = (row << 1) | bits[y][x];
+			
+			int row_errors = 6, value = 0;
+			for (k=0 ; k<4 ; ++k)
+			{
+				int n = count_bits(row ^ row_codes[k]);
+				if (n < row_errors) { row_errors = n; value = k; }
+			}
+			if (row_errors > 1) { errors = MARKER_MAX_ERRORS + 1; break; }
+			errors += row_errors;
+			id = (id << 2) | value;
+		}
+		
+		if (errors < best_errors)
+		{
+			best_errors = errors;
+			best_rotation = r;
+			best_id = id;
+			ambiguous = 0;
+		}
+		else if (errors == best_errors && errors <= MARKER_MAX_ERRORS) ambiguous = 1;
+		
+		for (y=0 ; y<5 ; ++y)
+		{
+			for (x=0 ; x<5 ; ++x) rotated[y][x] = bits[x][4-y];
+		}
+		memcpy(bits, rotated, sizeof(bits));
+	}
+	if (best_rotation < 0 || ambiguous) return 0;
+	
+	// After r anticlockwise turns, the marker's top-left
+	// corner is corner r of the quadrilateral
+	marker->id = best_id;
+	for (k=0 ; k<4 ; ++k)
+	{
+		marker->x[k] = qx[(k + best_rotation) % 4];
+		marker->y[k] = qy[(k + best_rotation) % 4];
+	}
+	
+	return 1;
+}
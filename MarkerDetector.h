@@ -0,0 +1,88 @@
+//
+// MarkerDetector.h - MarkerDetector header file
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef MARKERDETECTOR_H
+#define MARKERDETECTOR_H
+
+// Maximum number of markers reported per frame
+#define MAX_MARKERS 32
+
+// Adaptive threshold: a pixel is dark if it is more than
+// MARKER_THRESHOLD_OFFSET grey levels below the mean of the
+// (2*MARKER_THRESHOLD_RADIUS+1) pixel square around it.
+// Both are measured on the half size image.
+#define MARKER_THRESHOLD_RADIUS 10
+#define MARKER_THRESHOLD_OFFSET 7
+
+// Shortest side of a marker on the half size image (pixels)
+#define MARKER_MIN_SIDE 10
+
+// Smallest difference (grey levels) between the darkest
+// and brightest cells of a marker
+#define MARKER_MIN_CONTRAST 20
+
+// Most bit errors corrected in one marker (at most one per row)
+#define MARKER_MAX_ERRORS 2
+
+// One detected marker. Corners are in pixels with the
+// centre of the image's top-left pixel at (0,0) (so the
+// image's top-left corner is at (-0.5,-0.5)), starting at
+// the marker's top-left corner and going clockwise.
+struct Marker
+{
+	int id;
+	float x[4], y[4];
+};
+
+// Finds square fiducial markers using the original ArUco
+// layout: a black border around a 5x5 grid of bits, each
+// row holding 2 bits of the 10-bit id. Candidates are found
+// on a half size image and their corners refined on the
+// full size image. All buffers are allocated by init, so
+// nothing is allocated per frame.
+class MarkerDetector
+{
+public:
+	MarkerDetector();
+	~MarkerDetector();
+	
+	// Allocate buffers for w x h grey images
+	int init(int w, int h);
+	
+	// Find markers in a top-down grey image. Returns the
+	// number of markers found.
+	int process(unsigned char *pGrey);
+	
+	Marker *markers();
+	int numMarkers();
+	
+private:
+	int width, height;
+	int half_width, half_height;
+	
+	unsigned char *half;	// half size grey image
+	unsigned int *integral;	// integral image of half
+	unsigned char *binary;	// 1 for dark pixels of half
+	int *labels;	// component label of each dark pixel
+	int *parent;	// union-find parents of labels
+	int *first_pixel;	// first pixel (in raster order) of each component
+	int *box;	// bounding box of each component (4 ints)
+	int *contour_x;	// outer contour of the current component
+	int *contour_y;
+	int max_contour;
+	
+	Marker marker_list[MAX_MARKERS];
+	int num_markers;
+	
+	void threshold();
+	int label();
+	int traceContour(int start, int component);
+	int fitQuad(int length, float *qx, float *qy);
+	void refineCorners(unsigned char *pGrey, float *qx, float *qy);
+	int decode(unsigned char *pGrey, float *qx, float *qy, Marker *marker);
+};
+
+#endif // MARKERDETECTOR_H
@@ -0,0 +1,155 @@
+//
+// Platform.cpp - Small platform abstraction layer for RobotEyez
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <time.h>
+#endif
+
+#include "Platform.h"
+
+//
+// This function returns the current value of a high
+// resolution timer in milliseconds
+//
+double get_time_ms()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency = {0};
+	LARGE_INTEGER counter;
+	
+	if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (1000.0 * counter.QuadPart) / frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return 1000.0 * ts.tv_sec + ts.tv_nsec / 1000000.0;
+#endif
+}
+
+void sleep_ms(double ms)
+{
+	if (ms <= 0) return;
+#ifdef _WIN32
+	Sleep((DWORD)ms);
+#else
+	struct timespec ts;
+	ts.tv_sec = (time_t)(ms / 1000);
+	ts.tv_nsec = (long)((ms - 1000.0 * ts.tv_sec) * 1000000.0);
+	nanosleep(&ts, NULL);
+#endif
+}
+
+#ifdef _WIN32
+
+Mutex::Mutex() { InitializeCriticalSection(&cs); }
+Mutex::~Mutex() { DeleteCriticalSection(&cs); }
+void Mutex::lock() { EnterCriticalSection(&cs); }
+void Mutex::unlock() { LeaveCriticalSection(&cs); }
+
+Semaphore::Semaphore() { h = CreateSemaphore(NULL, 0, 0x7fffffff, NULL); }
+Semaphore::~Semaphore() { CloseHandle(h); }
+void Semaphore::post() { ReleaseSemaphore(h, 1, NULL); }
+void Semaphore::wait() { WaitForSingleObject(h, INFINITE); }
+
+int Thread::start(void (*function)(void *), void *argument)
+{
+	thread_function = function;
+	thread_argument = argument;
+	h = (HANDLE)_beginthreadex(NULL, 0, run, this, 0, NULL);
+	if (h == 0) return 1;
+	running = 1;
+	return 0;
+}
+
+void Thread::join()
+{
+	if (!running) return;
+	WaitForSingleObject(h, INFINITE);
+	CloseHandle(h);
+	running = 0;
+}
+
+unsigned __stdcall Thread::run(void *thread)
+{
+	Thread *t = (Thread *)thread;
+	t->thread_function(t->thread_argument);
+	return 0;
+}
+
+long atomic_increment(volatile long *value) { return InterlockedIncrement(value); }
+long atomic_decrement(volatile long *value) { return InterlockedDecrement(value); }
+
+#else
+
+Mutex::Mutex() { pthread_mutex_init(&m, NULL); }
+Mutex::~Mutex() { pthread_mutex_destroy(&m); }
+void Mutex::lock() { pthread_mutex_lock(&m); }
+void Mutex::unlock() { pthread_mutex_unlock(&m); }
+
+Semaphore::Semaphore()
+{
+	pthread_mutex_init(&m, NULL);
+	pthread_cond_init(&c, NULL);
+	count = 0;
+}
+
+Semaphore::~Semaphore()
+{
+	pthread_cond_destroy(&c);
+	pthread_mutex_destroy(&m);
+}
+
+void Semaphore::post()
+{
+	pthread_mutex_lock(&m);
+	count++;
+	pthread_cond_signal(&c);
+	pthread_mutex_unlock(&m);
+}
+
+void Semaphore::wait()
+{
+	pthread_mutex_lock(&m);
+	while (count == 0) pthread_cond_wait(&c, &m);
+	count--;
+	pthread_mutex_unlock(&m);
+}
+
+int Thread::start(void (*function)(void *), void *argument)
+{
+	thread_function = function;
+	thread_argument = argument;
+	if (pthread_create(&t, NULL, run, this) != 0) return 1;
+	running = 1;
+	return 0;
+}
+
+void Thread::join()
+{
+	if (!running) return;
+	pthread_join(t, NULL);
+	running = 0;
+}
+
+void *Thread::run(void *thread)
+{
+	Thread *t = (Thread *)thread;
+	t->thread_function(t->thread_argument);
+	return NULL;
+}
+
+long atomic_increment(volatile long *value) { return __sync_add_and_fetch(value, 1); }
+long atomic_decrement(volatile long *value) { return __sync_sub_and_fetch(value, 1); }
+
+#endif
+
+// Threads are joined rather than left running when they
+// go out of scope
+Thread::Thread() { running = 0; }
+Thread::~Thread() { join(); }
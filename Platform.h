@@ -0,0 +1,98 @@
+//
+// Platform.h - Small platform abstraction layer for RobotEyez
+//
+// Website: http://batchloaf.wordpress.com
+//
+// The image processing stages only depend on what is
+// declared here, so they can be compiled and tested
+// away from DirectShow if required.
+//
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// SSE2 is always available on x64. On 32-bit x86 it
+// is only used if the compiler has been told it may
+// use it (e.g. cl /arch:SSE2 or gcc -msse2). Defining
+// NO_SSE2 builds the scalar code instead (for testing).
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(NO_SSE2)
+#define USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Returns a high resolution timestamp in milliseconds.
+// Only differences between two values are meaningful.
+double get_time_ms();
+
+// Sleep for the specified number of milliseconds
+void sleep_ms(double ms);
+
+// Mutual exclusion lock (a critical section on Windows)
+class Mutex
+{
+public:
+	Mutex();
+	~Mutex();
+	void lock();
+	void unlock();
+	
+private:
+#ifdef _WIN32
+	CRITICAL_SECTION cs;
+#else
+	pthread_mutex_t m;
+#endif
+};
+
+// Counting semaphore, used to wake a thread when work arrives
+class Semaphore
+{
+public:
+	Semaphore();
+	~Semaphore();
+	void post();
+	void wait();
+	
+private:
+#ifdef _WIN32
+	HANDLE h;
+#else
+	pthread_mutex_t m;
+	pthread_cond_t c;
+	int count;
+#endif
+};
+
+// A thread which runs function(argument) until it returns
+class Thread
+{
+public:
+	Thread();
+	~Thread();
+	int start(void (*function)(void *), void *argument);
+	void join();
+	
+private:
+	void (*thread_function)(void *);
+	void *thread_argument;
+	int running;
+#ifdef _WIN32
+	HANDLE h;
+	static unsigned __stdcall run(void *thread);
+#else
+	pthread_t t;
+	static void *run(void *thread);
+#endif
+};
+
+// Atomically add or subtract one and return the new value
+long atomic_increment(volatile long *value);
+long atomic_decrement(volatile long *value);
+
+#endif // PLATFORM_H
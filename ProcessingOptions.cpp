@@ -0,0 +1,290 @@
+//
+// ProcessingOptions.cpp - Processing stage command line options
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ProcessingOptions.h"
+
+static int option_error(const char **error, const char *message)
+{
+	*error = message;
+	return -1;
+}
+
+// Read the X Y WIDTH HEIGHT arguments of a region of
+// interest. Returns 0 on success or 1 if they are invalid.
+static int read_region(int argc, char **argv, int *n, OutputRegion *region)
+{
+	if (*n + 4 >= argc) return 1;
+	
+	region->x = atoi(argv[++*n]);
+	region->y = atoi(argv[++*n]);
+	region->w = atoi(argv[++*n]);
+	region->h = atoi(argv[++*n]);
+	
+	return (region->x < 0 || region->y < 0 || region->w < 0 || region->h < 0);
+}
+
+//
+// Available options:
+//
+//		/command COMMAND_TO_RUN
+//		/track HMIN HMAX SMIN SMAX VMIN VMAX
+//		/background
+//		/fgmask
+//		/stack mean|median
+//		/reject THRESHOLD
+//		/undistort CALIBRATION_FILE
+//		/features MAX_FEATURES
+//		/markers
+//		/stats frame|period
+//		/sink FILENAME_PATTERN PERIOD_IN_MILLISECONDS
+//		/sinkqueue LENGTH
+//		/sinkdrop oldest|newest
+//		/sinkcommand COMMAND
+//		/sinkroi X Y WIDTH HEIGHT
+//		/sinklevel PYRAMID_LEVEL
+//		/roi X Y WIDTH HEIGHT
+//		/level PYRAMID_LEVEL
+//
+// /roi and /level choose the part of each saved frame that
+// is written: a region (in full size pixels from the top
+// left, with a WIDTH or HEIGHT of 0 meaning the rest of the
+// frame) of a copy of the frame halved in size PYRAMID_LEVEL
+// times. /sinkroi and /sinklevel do the same for the last sink.
+//
+int parse_processing_option(int argc, char **argv, int *position,
+	ProcessingSettings *s, const char **error)
+{
+	int n = *position;
+	
+	if (strcmp(argv[n], "/command") == 0)
+	{
+		// Set command to specified string
+		if (++n < argc)
+		{
+			// Copy device name into char buffer
+			strncpy(s->command, argv[n], STRING_LENGTH - 1);
+			s->command[STRING_LENGTH - 1] = '\0';
+			
+			// Remember to choose by name rather than number
+			s->run_command = 1;
+		}
+		else return option_error(error, "Error: invalid command specified");
+	}
+	else if (strcmp(argv[n], "/track") == 0)
+	{
+		// Add a colour class to track (HSV range)
+		if (s->number_colour_targets >= MAX_COLOUR_CLASSES)
+			return option_error(error, "Error: too many colour targets specified");
+		if (n + 6 >= argc)
+			return option_error(error, "Error: invalid colour target specified");
+		
+		for (int i=0 ; i<6 ; ++i)
+		{
+			s->colour_targets[s->number_colour_targets][i] = atoi(argv[++n]);
+		}
+		s->number_colour_targets++;
+	}
+	else if (strcmp(argv[n], "/background") == 0)
+	{
+		// Set flag to enable background model
+		s->background = 1;
+	}
+	else if (strcmp(argv[n], "/fgmask") == 0)
+	{
+		// Set flags to save foreground mask with each image file
+		s->background = 1;
+		s->save_foreground_mask = 1;
+	}
+	else if (strcmp(argv[n], "/stack") == 0)
+	{
+		// Set mode for stacking frames between captures
+		if (++n >= argc) return option_error(error, "Error: invalid stacking mode");
+		
+		if (strcmp(argv[n], "mean") == 0) s->stack_mode = STACK_MEAN;
+		else if (strcmp(argv[n], "median") == 0) s->stack_mode = STACK_MEDIAN;
+		else return option_error(error, "Error: invalid stacking mode");
+	}
+	else if (strcmp(argv[n], "/reject") == 0)
+	{
+		// Set outlier rejection threshold for stacking
+		if (++n < argc) s->stack_reject = atoi(argv[n]);
+		else return option_error(error, "Error: invalid rejection threshold");
+		
+		if (s->stack_reject < 0 || s->stack_reject > 255)
+			return option_error(error, "Error: invalid rejection threshold");
+	}
+	else if (strcmp(argv[n], "/undistort") == 0)
+	{
+		// Set calibration file for lens correction
+		if (++n < argc)
+		{
+			strncpy(s->calibration_file, argv[n], STRING_LENGTH - 1);
+			s->calibration_file[STRING_LENGTH - 1] = '\0';
+			s->lens_correction = 1;
+		}
+		else return option_error(error, "Error: invalid calibration file specified");
+	}
+	else if (strcmp(argv[n], "/features") == 0)
+	{
+		// Set maximum number of features to track
+		if (++n < argc) s->max_features = atoi(argv[n]);
+		else return option_error(error, "Error: invalid number of features specified");
+		
+		if (s->max_features <= 0)
+			return option_error(error, "Error: invalid number of features specified");
+	}
+	else if (strcmp(argv[n], "/markers") == 0)
+	{
+		// Set flag to detect fiducial markers
+		s->markers = 1;
+	}
+	else if (strcmp(argv[n], "/stats") == 0)
+	{
+		// Set how often image statistics are printed
+		if (++n >= argc) return option_error(error, "Error: invalid stats mode");
+		
+		if (strcmp(argv[n], "frame") == 0) s->stats_mode = STATS_FRAME;
+		else if (strcmp(argv[n], "period") == 0) s->stats_mode = STATS_PERIOD;
+		else return option_error(error, "Error: invalid stats mode");
+	}
+	else if (strcmp(argv[n], "/sink") == 0)
+	{
+		// Add a sink which writes frames to files named by
+		// FILENAME_PATTERN (which may contain %d or %04d etc
+		// for the frame number) at most once per period
+		if (s->number_sinks >= MAX_SINKS)
+			return option_error(error, "Error: too many sinks specified");
+		if (n + 2 >= argc) return option_error(error, "Error: invalid sink specified");
+		
+		SinkSettings *sink = &s->sinks[s->number_sinks++];
+		strncpy(sink->pattern, argv[++n], STRING_LENGTH - 20);
+		sink->pattern[STRING_LENGTH - 20] = '\0';
+		sink->period = atof(argv[++n]);
+		sink->queue_length = SINK_QUEUE_LENGTH;
+		sink->drop_policy = SINK_DROP_OLDEST;
+		strcpy(sink->command, "");
+		memset(&sink->region, 0, sizeof(OutputRegion));
+		
+		if (sink->period < 0) return option_error(error, "Error: invalid sink period specified");
+	}
+	else if (strcmp(argv[n], "/sinkqueue") == 0)
+	{
+		// Set queue length of the last sink
+		if (s->number_sinks == 0) return option_error(error, "Error: /sinkqueue must follow /sink");
+		if (++n < argc) s->sinks[s->number_sinks-1].queue_length = atoi(argv[n]);
+		else return option_error(error, "Error: invalid sink queue length specified");
+		
+		if (s->sinks[s->number_sinks-1].queue_length < 1)
+			return option_error(error, "Error: invalid sink queue length specified");
+	}
+	else if (strcmp(argv[n], "/sinkdrop") == 0)
+	{
+		// Set which frame the last sink drops when its queue is full
+		if (s->number_sinks == 0) return option_error(error, "Error: /sinkdrop must follow /sink");
+		if (++n >= argc) return option_error(error, "Error: invalid sink drop policy");
+		
+		if (strcmp(argv[n], "oldest") == 0) s->sinks[s->number_sinks-1].drop_policy = SINK_DROP_OLDEST;
+		else if (strcmp(argv[n], "newest") == 0) s->sinks[s->number_sinks-1].drop_policy = SINK_DROP_NEWEST;
+		else return option_error(error, "Error: invalid sink drop policy");
+	}
+	else if (strcmp(argv[n], "/sinkcommand") == 0)
+	{
+		// Set command run on each file written by the last sink
+		if (s->number_sinks == 0) return option_error(error, "Error: /sinkcommand must follow /sink");
+		if (++n >= argc) return option_error(error, "Error: invalid sink command specified");
+		
+		char *command = s->sinks[s->number_sinks-1].command;
+		strncpy(command, argv[n], STRING_LENGTH - 1);
+		command[STRING_LENGTH - 1] = '\0';
+	}
+	else if (strcmp(argv[n], "/sinkroi") == 0)
+	{
+		// Set region of interest of the last sink
+		if (s->number_sinks == 0) return option_error(error, "Error: /sinkroi must follow /sink");
+		if (read_region(argc, argv, &n, &s->sinks[s->number_sinks-1].region) != 0)
+			return option_error(error, "Error: invalid sink region of interest specified");
+	}
+	else if (strcmp(argv[n], "/sinklevel") == 0)
+	{
+		// Set pyramid level of the frames written by the last sink
+		if (s->number_sinks == 0) return option_error(error, "Error: /sinklevel must follow /sink");
+		if (++n < argc) s->sinks[s->number_sinks-1].region.level = atoi(argv[n]);
+		else return option_error(error, "Error: invalid sink pyramid level specified");
+		
+		if (s->sinks[s->number_sinks-1].region.level < 0 ||
+			s->sinks[s->number_sinks-1].region.level >= MAX_PYRAMID_LEVELS)
+			return option_error(error, "Error: invalid sink pyramid level specified");
+	}
+	else if (strcmp(argv[n], "/roi") == 0)
+	{
+		// Set region of interest of saved frames
+		if (read_region(argc, argv, &n, &s->save_region) != 0)
+			return option_error(error, "Error: invalid region of interest specified");
+	}
+	else if (strcmp(argv[n], "/level") == 0)
+	{
+		// Set pyramid level of saved frames
+		if (++n < argc) s->save_region.level = atoi(argv[n]);
+		else return option_error(error, "Error: invalid pyramid level specified");
+		
+		if (s->save_region.level < 0 || s->save_region.level >= MAX_PYRAMID_LEVELS)
+			return option_error(error, "Error: invalid pyramid level specified");
+	}
+	else
+	{
+		// Not a processing option
+		return 0;
+	}
+	
+	*position = n;
+	return 1;
+}
+
+int configure_processor(FrameProcessor *p, ProcessingSettings *s,
+	const char *file_label, const char **error)
+{
+	for (int n=0 ; n<s->number_colour_targets ; ++n)
+	{
+		p->addColourTarget(
+			s->colour_targets[n][0], s->colour_targets[n][1],
+			s->colour_targets[n][2], s->colour_targets[n][3],
+			s->colour_targets[n][4], s->colour_targets[n][5]);
+	}
+	if (s->background)
+		p->enableBackgroundModel(s->save_foreground_mask);
+	if (s->stack_mode)
+		p->enableStacking(s->stack_mode, s->stack_reject);
+	if (s->lens_correction &&
+		p->enableLensCorrection(s->calibration_file) != 0)
+		return option_error(error, "Error: could not load calibration file");
+	if (s->max_features > 0 &&
+		p->enableFeatureTracking(s->max_features) != 0)
+		return option_error(error, "Error: could not enable feature tracking");
+	if (s->markers &&
+		p->enableMarkerDetection() != 0)
+		return option_error(error, "Error: could not enable marker detection");
+	if (s->stats_mode) p->enableStats(s->stats_mode);
+	if (p->setSaveRegion(&s->save_region) != 0)
+		return option_error(error, "Error: region of interest is outside the frame");
+	for (int n=0 ; n<s->number_sinks ; ++n)
+	{
+		SinkSettings *sink = &s->sinks[n];
+		char pattern[STRING_LENGTH];
+		sprintf(pattern, "%s%s", file_label, sink->pattern);
+		if (p->addSink(pattern, sink->period,
+				sink->queue_length, sink->drop_policy, sink->command, &sink->region) != 0)
+			return option_error(error, "Error: invalid sink filename pattern or region");
+	}
+	if (s->number_sinks > 0 && p->startSinks() != 0)
+		return option_error(error, "Error: could not start sinks");
+	if (s->run_command) p->setCommand(s->command);
+	
+	return 0;
+}
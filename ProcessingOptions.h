@@ -0,0 +1,59 @@
+//
+// ProcessingOptions.h - ProcessingOptions header file
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef PROCESSINGOPTIONS_H
+#define PROCESSINGOPTIONS_H
+
+#include "FrameProcessor.h"
+
+// Settings for one frame sink
+struct SinkSettings
+{
+	char pattern[STRING_LENGTH];
+	double period;
+	int queue_length;
+	int drop_policy;
+	char command[STRING_LENGTH];
+	OutputRegion region;
+};
+
+// Settings for the processing stages, shared by RobotEyez
+// (live frames) and RobotReplay (recorded frames). All
+// zero means no processing stages are enabled.
+struct ProcessingSettings
+{
+	int run_command;
+	char command[STRING_LENGTH];
+	int colour_targets[MAX_COLOUR_CLASSES][6];
+	int number_colour_targets;
+	int background;
+	int save_foreground_mask;
+	int stack_mode;
+	int stack_reject;
+	char calibration_file[STRING_LENGTH];
+	int lens_correction;
+	int max_features;
+	int markers;
+	int stats_mode;
+	OutputRegion save_region;
+	SinkSettings sinks[MAX_SINKS];
+	int number_sinks;
+};
+
+// Parse the option at argv[*position] if it is a processing
+// option, leaving *position at its last argument. Returns 1
+// if the option was used, 0 if it is not a processing
+// option or -1 (with *error set) if it is invalid.
+int parse_processing_option(int argc, char **argv, int *position,
+	ProcessingSettings *s, const char **error);
+
+// Enable the processing stages selected in the settings.
+// file_label (e.g. "cam2_") goes at the start of each sink
+// filename. Returns 0 on success or -1 with *error set.
+int configure_processor(FrameProcessor *p, ProcessingSettings *s,
+	const char *file_label, const char **error);
+
+#endif // PROCESSINGOPTIONS_H
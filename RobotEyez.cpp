@@ -11,6 +11,8 @@
 #include <dshow.h>
 
 #include "FrameTransformFilter.h"
+#include "ProcessingOptions.h"
+#include "CaptureScheduler.h"
 
 // For some reason, this is not included in the
 // DirectShow headers. However, it's exported
@@ -18,9 +20,42 @@
 // here as extern.
 EXTERN_C const CLSID CLSID_NullRenderer;
 
-// Used for various strings - filenames, command line args,
-// etc (also defined in FrameTransformFilter.cpp)
-#define STRING_LENGTH 200
+// Maximum number of cameras captured at the same time
+#define MAX_CAMERAS 8
+
+// Capture settings for one camera. Options given on the
+// command line before the first /devnum or /devname are
+// defaults for every camera. Options given after one
+// apply only to that camera.
+struct CameraSettings
+{
+	int width;
+	int height;
+	int delay;
+	int period;
+	int frames;
+	int number_files;
+	int device_number;
+	char device_name[STRING_LENGTH];
+	char filetype_string[4];
+	int show_renderer;
+	ProcessingSettings processing;
+};
+
+// DirectShow objects and capture state for one camera
+struct Camera
+{
+	CameraSettings settings;
+	IGraphBuilder *pGraph;
+	ICaptureGraphBuilder2 *pBuilder;
+	IBaseFilter *pCap;
+	IBaseFilter *pTransform;
+	IBaseFilter *pNullRenderer;
+	IMediaControl *pMediaControl;
+	IAMStreamConfig *pStreamConfig;
+	FrameTransformFilter *pFrameTransformFilter;
+	FrameProcessor *pFrameProcessor;	// the filter's processing stages
+};
 
 // DirectShow objects
 HRESULT hr;
@@ -28,28 +63,27 @@ ICreateDevEnum *pDevEnum = NULL;
 IEnumMoniker *pEnum = NULL;
 IMoniker *pMoniker = NULL;
 IPropertyBag *pPropBag = NULL;
-IGraphBuilder *pGraph = NULL;
-ICaptureGraphBuilder2 *pBuilder = NULL;
-IBaseFilter *pCap = NULL;
-IBaseFilter *pTransform = NULL;
-IBaseFilter *pNullRenderer = NULL;
-IMediaControl *pMediaControl = NULL;
-IAMStreamConfig *pStreamConfig = NULL;
+Camera cameras[MAX_CAMERAS];
+int number_cameras = 0;
 
 void exit_message(const char* error_message, int error)
 {
 	// Print an error message
-	fprintf(stderr, error_message);
+	fputs(error_message, stderr);
 	fprintf(stderr, "\n");
 	
 	// Clean up DirectShow / COM stuff
-	if (pMediaControl != NULL) pMediaControl->Release();
-	if (pStreamConfig != NULL) pStreamConfig->Release();
-	if (pNullRenderer != NULL) pNullRenderer->Release();
-	if (pTransform != NULL) pTransform->Release();
-	if (pCap != NULL) pCap->Release();
-	if (pBuilder != NULL) pBuilder->Release();
-	if (pGraph != NULL) pGraph->Release();
+	for (int n=0 ; n<number_cameras ; ++n)
+	{
+		Camera *c = &cameras[n];
+		if (c->pMediaControl != NULL) c->pMediaControl->Release();
+		if (c->pStreamConfig != NULL) c->pStreamConfig->Release();
+		if (c->pNullRenderer != NULL) c->pNullRenderer->Release();
+		if (c->pTransform != NULL) c->pTransform->Release();
+		if (c->pCap != NULL) c->pCap->Release();
+		if (c->pBuilder != NULL) c->pBuilder->Release();
+		if (c->pGraph != NULL) c->pGraph->Release();
+	}
 	if (pPropBag != NULL) pPropBag->Release();
 	if (pMoniker != NULL) pMoniker->Release();
 	if (pEnum != NULL) pEnum->Release();
@@ -60,29 +94,256 @@ void exit_message(const char* error_message, int error)
 	exit(error);
 }
 
+//
+// Add a new camera with a copy of the default settings
+// and return a pointer to its settings
+//
+CameraSettings *add_camera(CameraSettings *defaults)
+{
+	if (number_cameras >= MAX_CAMERAS)
+		exit_message("Error: too many cameras specified", 1);
+	
+	Camera *c = &cameras[number_cameras++];
+	memset(c, 0, sizeof(Camera));
+	c->settings = *defaults;
+	return &c->settings;
+}
+
+//
+// Find the moniker of the camera's capture device (by
+// number or by name) and leave it in pMoniker
+//
+void find_device(CameraSettings *s)
+{
+	VARIANT var;
+	char char_buffer[STRING_LENGTH];
+	int n = 0;
+	
+	// Start from the first device every time
+	pEnum->Reset();
+	while(1)
+	{
+		// Access next device
+		if (pMoniker != NULL)
+		{
+			pMoniker->Release();
+			pMoniker = NULL;
+		}
+		hr = pEnum->Next(1, &pMoniker, NULL);
+		if (hr == S_OK)
+		{
+			n++; // increment device count
+		}
+		else
+		{
+			if (s->device_number == 0)
+			{
+				fprintf(stderr,
+					"Video capture device %s not found\n",
+					s->device_name);
+			}
+			else
+			{
+				fprintf(stderr,
+					"Video capture device %d not found\n",
+					s->device_number);
+			}
+			exit_message("", 1);
+		}
+		
+		// If device was specified by name rather than number...
+		if (s->device_number == 0)
+		{
+			// Get video input device name
+			hr = pMoniker->BindToStorage(0, 0, IID_PPV_ARGS(&pPropBag));
+			if (hr == S_OK)
+			{
+				// Get current device name
+				VariantInit(&var);
+				hr = pPropBag->Read(L"FriendlyName", &var, 0);
+				
+				// Convert to a normal C string, i.e. char*
+				sprintf(char_buffer, "%ls", var.bstrVal);
+				VariantClear(&var);
+				pPropBag->Release();
+				pPropBag = NULL;
+				
+				// Exit loop if current device name matched devname
+				if (strcmp(s->device_name, char_buffer) == 0) break;
+			}
+			else
+			{
+				exit_message("Error getting device names", 1);
+			}
+		}
+		else if (n >= s->device_number) break;
+	}
+}
+
+//
+// Build the filter graph for one camera:
+// capture filter -> frame transform filter -> renderer
+//
+void build_camera_graph(Camera *c, char *label)
+{
+	CameraSettings *s = &c->settings;
+	VARIANT var;
+	
+	// Create filter graph
+	hr = CoCreateInstance(CLSID_FilterGraph, NULL,
+			CLSCTX_INPROC_SERVER, IID_IGraphBuilder,
+			(void**)&c->pGraph);
+	if (hr != S_OK)
+		exit_message("Could not create filter graph", 1);
+	
+	// Create capture graph builder.
+	hr = CoCreateInstance(CLSID_CaptureGraphBuilder2, NULL,
+			CLSCTX_INPROC_SERVER, IID_ICaptureGraphBuilder2,
+			(void **)&c->pBuilder);
+	if (hr != S_OK)
+		exit_message("Could not create capture graph builder", 1);
+	
+	// Attach capture graph builder to graph
+	hr = c->pBuilder->SetFiltergraph(c->pGraph);
+	if (hr != S_OK)
+		exit_message("Could not attach capture graph builder to graph", 1);
+	
+	// Get moniker for specified video input device,
+	// or for the first device if no device number
+	// was specified.
+	find_device(s);
+	
+	// Get video input device name
+	hr = pMoniker->BindToStorage(0, 0, IID_PPV_ARGS(&pPropBag));
+	VariantInit(&var);
+	hr = pPropBag->Read(L"FriendlyName", &var, 0);
+	fprintf(stderr, "%sCapture device: %ls\n", label, var.bstrVal);
+	VariantClear(&var);
+	pPropBag->Release();
+	pPropBag = NULL;
+	
+	// Create capture filter and add to graph
+	hr = pMoniker->BindToObject(0, 0,
+					IID_IBaseFilter, (void**)&c->pCap);
+	if (hr != S_OK) exit_message("Could not create capture filter", 1);
+		
+	// Add capture filter to graph
+	hr = c->pGraph->AddFilter(c->pCap, L"Capture Filter");
+	if (hr != S_OK) exit_message("Could not add capture filter to graph", 1);
+	
+	// Create frame transform filter
+	c->pFrameTransformFilter = new FrameTransformFilter(s->width, s->height);
+	if (!c->pFrameTransformFilter)
+		exit_message("Could not create frame transform filter", 1);
+	c->pFrameProcessor = c->pFrameTransformFilter->processor();
+	c->pFrameProcessor->setLabel(label);
+	
+	// Sink filenames are labelled like the saved frames
+	char file_label[20] = "";
+	if (number_cameras > 1) sprintf(file_label, "cam%d_", (int)(c - cameras) + 1);
+	const char *error;
+	if (configure_processor(c->pFrameProcessor, &s->processing, file_label, &error) != 0)
+		exit_message(error, 1);
+	
+	// NB Object will be automatically deleted when pTransform is released
+	hr = c->pFrameTransformFilter->QueryInterface(
+			IID_IBaseFilter, reinterpret_cast<void**>(&c->pTransform));
+	if (hr != S_OK)
+		exit_message("Could not get IBaseFilter interface of transform filter", 1);
+	
+	// Add transform filter to graph
+	hr = c->pGraph->AddFilter(c->pTransform, L"FrameTransform");
+	if (hr != S_OK)
+		exit_message("Could not add frame transform filter to filter graph", 1);
+	
+	// Create Null Renderer filter
+	hr = CoCreateInstance(CLSID_NullRenderer, NULL,
+		CLSCTX_INPROC_SERVER, IID_IBaseFilter,
+		(void**)&c->pNullRenderer);
+	if (hr != S_OK)
+		exit_message("Could not create Null Renderer filter", 1);
+	
+	// Add Null Renderer filter to filter graph
+	hr = c->pGraph->AddFilter(c->pNullRenderer, L"NullRender");
+	if (hr != S_OK)
+		exit_message("Could not add Null Renderer to filter graph", 1);
+	
+	// Try to set video resolution
+	hr = c->pBuilder->FindInterface(
+				&PIN_CATEGORY_CAPTURE,
+				&MEDIATYPE_Video,
+				c->pCap,
+				IID_IAMStreamConfig,
+				(void**)&c->pStreamConfig);
+	if (hr != S_OK)
+	{
+		fprintf(stderr, "Could not get IAMStreamConfig interface: ");
+		if (hr == E_FAIL) fprintf(stderr, "E_FAIL\n");
+		else if (hr == E_NOINTERFACE) fprintf(stderr, "E_NOINTERFACE\n");
+		else if (hr == E_POINTER) fprintf(stderr, "E_POINTER\n");
+	}
+	else
+	{
+		// Successfully got the IAMStreamConfig interface
+		// Get, modify and set video format
+		AM_MEDIA_TYPE *pmt = 0;
+		hr = c->pStreamConfig->GetFormat(&pmt);
+		if (hr != S_OK)	exit_message("Error getting capture filter format", 1);
+		if (pmt->formattype != FORMAT_VideoInfo)
+			exit_message("AM_MEDIA_TYPE format type is not FORMAT_VideoInfo", 1);
+		VIDEOINFOHEADER *pvi = (VIDEOINFOHEADER *)pmt->pbFormat;
+		pvi->bmiHeader.biWidth = s->width;
+		pvi->bmiHeader.biHeight = s->height;
+		hr = c->pStreamConfig->SetFormat(pmt);
+		DeleteMediaType(pmt);
+	}
+	
+	// Connect up the filter graph's preview stream
+	if (s->show_renderer)
+	{
+		hr = c->pBuilder->RenderStream(
+				&PIN_CATEGORY_CAPTURE, &MEDIATYPE_Video,
+				c->pCap, c->pTransform, NULL);
+	}
+	else
+	{
+		hr = c->pBuilder->RenderStream(
+				&PIN_CATEGORY_CAPTURE, &MEDIATYPE_Video,
+				c->pCap, c->pTransform, c->pNullRenderer);
+	}
+	if (hr != S_OK && hr != VFW_S_NOPREVIEWPIN)
+		exit_message("Could not render preview video stream", 1);
+			
+	// Get media control interfaces to graph builder object
+	hr = c->pGraph->QueryInterface(IID_IMediaControl,
+					(void**)&c->pMediaControl);
+	if (hr != S_OK)
+		exit_message("Could not get media control interface", 1);
+}
+
 int main(int argc, char **argv)
 {
 	// Default capture settings
-	int width = 640;
-	int height = 480;
-	int delay = 2000;
-	int period = 1000;
-	int frames = 1;
-	int number_files = 0;
+	CameraSettings defaults;
+	CameraSettings *s = &defaults;
+	memset(&defaults, 0, sizeof(defaults));
+	defaults.width = 640;
+	defaults.height = 480;
+	defaults.delay = 2000;
+	defaults.period = 1000;
+	defaults.frames = 1;
+	defaults.device_number = 1;
+	strcpy(defaults.filetype_string, "pgm");
 	int list_devices = 0;
-	int device_number = 1;
-	char device_name[STRING_LENGTH];
-	char filename[STRING_LENGTH];
-	char filetype_string[4] = "pgm";
-	int run_command = 0;
-	char command[STRING_LENGTH];
-	int show_renderer = 0;
+	int stereo = 0;
+	int stereo_disparities = STEREO_DISPARITIES;
+	double stereo_tolerance = STEREO_TOLERANCE;
+	StereoPair *pStereoPair = NULL;
 	
 	// Other variables
 	char char_buffer[STRING_LENGTH];
-
-	// Default device name and output filename
-	strcpy(device_name, "");
+	char filename[STRING_LENGTH];
+	char label[STRING_LENGTH];
 	
 	// Information message
 	fprintf(stderr, "\nRobotEyez.exe - http://batchloaf.wordpress.com\n");
@@ -103,6 +364,33 @@ int main(int argc, char **argv)
 	//		/devlist
 	//		/preview
 	//		/bmp
+	//		/track HMIN HMAX SMIN SMAX VMIN VMAX
+	//		/background
+	//		/fgmask
+	//		/stack mean|median
+	//		/reject THRESHOLD
+	//		/undistort CALIBRATION_FILE
+	//		/features MAX_FEATURES
+	//		/markers
+	//		/stats frame|period
+	//		/sink FILENAME_PATTERN PERIOD_IN_MILLISECONDS
+	//		/sinkqueue LENGTH
+	//		/sinkdrop oldest|newest
+	//		/sinkcommand COMMAND
+	//		/sinkroi X Y WIDTH HEIGHT
+	//		/sinklevel PYRAMID_LEVEL
+	//		/roi X Y WIDTH HEIGHT
+	//		/level PYRAMID_LEVEL
+	//		/stereo
+	//		/disparities NUMBER_OF_DISPARITIES
+	//		/stereotolerance TOLERANCE_IN_MILLISECONDS
+	//
+	// /devnum and /devname can be given more than once to
+	// capture from several cameras at the same time. Options
+	// before the first of them apply to every camera and
+	// options after each one apply only to that camera.
+	// /stereo uses the first two cameras as a stereo pair
+	// (left then right).
 	//
 	int n = 1;
 	while (n < argc)
@@ -116,67 +404,71 @@ int main(int argc, char **argv)
 		else if (strcmp(argv[n], "/preview") == 0)
 		{
 			// Set flag to list devices rather than capture image
-			show_renderer = 1;
+			s->show_renderer = 1;
 		}
 		else if (strcmp(argv[n], "/width") == 0)
 		{
 			// Set frame width to specified value
-			if (++n < argc) width = atoi(argv[n]);
+			if (++n < argc) s->width = atoi(argv[n]);
 			else exit_message("Error: invalid width specified", 1);
 			
-			if (delay <= 0)
+			if (s->width <= 0)
 				exit_message("Error: invalid width specified", 1);
 		}
 		else if (strcmp(argv[n], "/height") == 0)
 		{
 			// Set frame height to specified value
-			if (++n < argc) height = atoi(argv[n]);
+			if (++n < argc) s->height = atoi(argv[n]);
 			else exit_message("Error: invalid height specified", 1);
 			
-			if (delay <= 0)
+			if (s->height <= 0)
 				exit_message("Error: invalid height specified", 1);
 		}
 		else if (strcmp(argv[n], "/delay") == 0)
 		{
 			// Set snapshot delay to specified value
-			if (++n < argc) delay = atoi(argv[n]);
+			if (++n < argc) s->delay = atoi(argv[n]);
 			else exit_message("Error: invalid delay specified", 1);
 			
-			if (delay <= 0)
+			if (s->delay <= 0)
 				exit_message("Error: invalid delay specified", 1);
 		}
 		else if (strcmp(argv[n], "/period") == 0)
 		{
 			// Set time period between captures
-			if (++n < argc) period = atoi(argv[n]);
+			if (++n < argc) s->period = atoi(argv[n]);
 			else exit_message("Error: invalid period specified", 1);
 			
-			if (period <= 0)
+			if (s->period <= 0)
 				exit_message("Error: invalid period specified", 1);
 		}
 		else if (strcmp(argv[n], "/frames") == 0)
 		{
 			// Set number of frames to capture
-			if (++n < argc) frames = atoi(argv[n]);
+			if (++n < argc) s->frames = atoi(argv[n]);
 			else exit_message("Error: invalid number of frames specified", 1);
 		}
 		else if (strcmp(argv[n], "/number_files") == 0)
 		{
 			// Set flag to include numbers in image filenames
-			number_files = 1;
+			s->number_files = 1;
 		}
 		else if (strcmp(argv[n], "/devnum") == 0)
 		{
-			// Set device number to specified value
-			if (++n < argc) device_number = atoi(argv[n]);
+			// Start a new camera, with the current defaults,
+			// and set its device number to specified value
+			s = add_camera(&defaults);
+			if (++n < argc) s->device_number = atoi(argv[n]);
 			else exit_message("Error: invalid device number", 1);
 			
-			if (device_number <= 0)
+			if (s->device_number <= 0)
 				exit_message("Error: invalid device number", 1);
 		}
 		else if (strcmp(argv[n], "/devname") == 0)
 		{
-			// Set device number to specified value
+			// Start a new camera, with the current defaults,
+			// and set its device name to specified value
+			s = add_camera(&defaults);
 			if (++n < argc)
 			{
 				// Copy device name into char buffer
@@ -186,77 +478,79 @@ int main(int argc, char **argv)
 				// provided string into device_name
 				if (char_buffer[0] == '"')
 				{
-					strncat(device_name, char_buffer, strlen(char_buffer)-2);
+					strncat(s->device_name, char_buffer, strlen(char_buffer)-2);
 				}
 				else
 				{
-					strcpy(device_name, char_buffer);
+					strcpy(s->device_name, char_buffer);
 				}
 				
 				// Remember to choose by name rather than number
-				device_number = 0;
+				s->device_number = 0;
 			}
 			else exit_message("Error: invalid device name", 1);
 		}
-		else if (strcmp(argv[n], "/command") == 0)
-		{
-			// Set command to specified string
-			if (++n < argc)
-			{
-				// Copy device name into char buffer
-				strncpy(command, argv[n], STRING_LENGTH);
-				
-				// Remember to choose by name rather than number
-				run_command = 1;
-			}
-			else exit_message("Error: invalid command specified", 1);
-		}
 		else if (strcmp(argv[n], "/bmp") == 0)
 		{
 			// Set flag to list devices rather than capture image
-			strcpy(filetype_string, "bmp");
+			strcpy(s->filetype_string, "bmp");
+		}
+		else if (strcmp(argv[n], "/stereo") == 0)
+		{
+			// Set flag to match the first two cameras as a stereo pair
+			stereo = 1;
+		}
+		else if (strcmp(argv[n], "/disparities") == 0)
+		{
+			// Set number of disparities searched by stereo matching
+			if (++n < argc) stereo_disparities = atoi(argv[n]);
+			else exit_message("Error: invalid number of disparities specified", 1);
+			
+			if (stereo_disparities < 1 || stereo_disparities > 255)
+				exit_message("Error: invalid number of disparities specified", 1);
+		}
+		else if (strcmp(argv[n], "/stereotolerance") == 0)
+		{
+			// Set tolerance for pairing stereo frames
+			if (++n < argc) stereo_tolerance = atof(argv[n]);
+			else exit_message("Error: invalid stereo tolerance specified", 1);
+			
+			if (stereo_tolerance < 0)
+				exit_message("Error: invalid stereo tolerance specified", 1);
 		}
 		else
 		{
-			// Unknown command line argument
-			fprintf(stderr, "Unrecognised option: %s\n", argv[n]);
-			exit_message("", 1);			
+			// Processing stage options (see ProcessingOptions.cpp)
+			const char *error;
+			int result = parse_processing_option(argc, argv, &n, &s->processing, &error);
+			if (result < 0) exit_message(error, 1);
+			
+			if (result == 0)
+			{
+				// Unknown command line argument
+				fprintf(stderr, "Unrecognised option: %s\n", argv[n]);
+				exit_message("", 1);			
+			}
 		}
 		
 		// Increment command line argument counter
 		n++;
 	}
 	
+	// If no device was specified, use the first one
+	if (number_cameras == 0) add_camera(&defaults);
+	
 	// Intialise COM
 	hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
 	if (hr != S_OK)
 		exit_message("Could not initialise COM", 1);
-
-	// Create filter graph
-	hr = CoCreateInstance(CLSID_FilterGraph, NULL,
-			CLSCTX_INPROC_SERVER, IID_IGraphBuilder,
-			(void**)&pGraph);
-	if (hr != S_OK)
-		exit_message("Could not create filter graph", 1);
 	
-	// Create capture graph builder.
-	hr = CoCreateInstance(CLSID_CaptureGraphBuilder2, NULL,
-			CLSCTX_INPROC_SERVER, IID_ICaptureGraphBuilder2,
-			(void **)&pBuilder);
-	if (hr != S_OK)
-		exit_message("Could not create capture graph builder", 1);
-
-	// Attach capture graph builder to graph
-	hr = pBuilder->SetFiltergraph(pGraph);
-	if (hr != S_OK)
-		exit_message("Could not attach capture graph builder to graph", 1);
-
 	// Create system device enumerator
 	hr = CoCreateInstance(CLSID_SystemDeviceEnum, NULL,
 			CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pDevEnum));
 	if (hr != S_OK)
 		exit_message("Could not crerate system device enumerator", 1);
-
+	
 	// Video input device enumerator
 	hr = pDevEnum->CreateClassEnumerator(
 					CLSID_VideoInputDeviceCategory, &pEnum, 0);
@@ -295,173 +589,72 @@ int main(int argc, char **argv)
 		}
 	}
 	
-	// Get moniker for specified video input device,
-	// or for the first device if no device number
-	// was specified.
-	VARIANT var;
-	n = 0;
-	while(1)
+	// Build one filter graph per camera. When there is more
+	// than one camera, each camera's output lines and image
+	// files are labelled with its number.
+	for (n=0 ; n<number_cameras ; ++n)
 	{
-		// Access next device
-		hr = pEnum->Next(1, &pMoniker, NULL);
+		if (number_cameras > 1) sprintf(label, "cam%d ", n+1);
+		else strcpy(label, "");
+		build_camera_graph(&cameras[n], label);
+	}
+	
+	// Set up stereo matching between the first two cameras
+	if (stereo)
+	{
+		if (number_cameras < 2)
+			exit_message("Error: stereo needs two cameras", 1);
+		if (cameras[0].settings.width != cameras[1].settings.width ||
+			cameras[0].settings.height != cameras[1].settings.height)
+			exit_message("Error: stereo cameras must have the same resolution", 1);
+		
+		pStereoPair = new StereoPair();
+		if (pStereoPair->init(cameras[0].settings.width, cameras[0].settings.height,
+				stereo_disparities, stereo_tolerance) != 0)
+			exit_message("Error: could not set up stereo matching", 1);
+		cameras[0].pFrameProcessor->setStereoPair(pStereoPair, STEREO_LEFT);
+		cameras[1].pFrameProcessor->setStereoPair(pStereoPair, STEREO_RIGHT);
+		
+		// Make both graphs use the same reference clock, so
+		// that their sample times can be compared
+		IMediaFilter *pMediaFilter = NULL;
+		IReferenceClock *pClock = NULL;
+		cameras[0].pGraph->SetDefaultSyncSource();
+		hr = cameras[0].pGraph->QueryInterface(IID_IMediaFilter, (void**)&pMediaFilter);
 		if (hr == S_OK)
 		{
-			n++; // increment device count
+			pMediaFilter->GetSyncSource(&pClock);
+			pMediaFilter->Release();
 		}
-		else
-		{
-			if (device_number == 0)
-			{
-				fprintf(stderr,
-					"Video capture device %s not found\n",
-					device_name);
-			}
-			else
-			{
-				fprintf(stderr,
-					"Video capture device %d not found\n",
-					device_number);
-			}
-			exit_message("", 1);
-		}
-		
-		// If device was specified by name rather than number...
-		if (device_number == 0)
+		if (pClock == NULL)
+			exit_message("Error: could not get reference clock for stereo pair", 1);
+		hr = cameras[1].pGraph->QueryInterface(IID_IMediaFilter, (void**)&pMediaFilter);
+		if (hr == S_OK)
 		{
-			// Get video input device name
-			hr = pMoniker->BindToStorage(0, 0, IID_PPV_ARGS(&pPropBag));
-			if (hr == S_OK)
-			{
-				// Get current device name
-				VariantInit(&var);
-				hr = pPropBag->Read(L"FriendlyName", &var, 0);
-				
-				// Convert to a normal C string, i.e. char*
-				sprintf(char_buffer, "%ls", var.bstrVal);
-				VariantClear(&var);
-				pPropBag->Release();
-				pPropBag = NULL;
-				
-				// Exit loop if current device name matched devname
-				if (strcmp(device_name, char_buffer) == 0) break;
-			}
-			else
-			{
-				exit_message("Error getting device names", 1);
-			}
+			hr = pMediaFilter->SetSyncSource(pClock);
+			pMediaFilter->Release();
 		}
-		else if (n >= device_number) break;
+		pClock->Release();
+		if (hr != S_OK)
+			exit_message("Error: could not share reference clock with stereo pair", 1);
 	}
 	
-	// Get video input device name
-	hr = pMoniker->BindToStorage(0, 0, IID_PPV_ARGS(&pPropBag));
-	VariantInit(&var);
-	hr = pPropBag->Read(L"FriendlyName", &var, 0);
-	fprintf(stderr, "Capture device: %ls\n", var.bstrVal);
-	VariantClear(&var);
-	
-	// Create capture filter and add to graph
-	hr = pMoniker->BindToObject(0, 0,
-					IID_IBaseFilter, (void**)&pCap);
-	if (hr != S_OK) exit_message("Could not create capture filter", 1);
-		
-	// Add capture filter to graph
-	hr = pGraph->AddFilter(pCap, L"Capture Filter");
-	if (hr != S_OK) exit_message("Could not add capture filter to graph", 1);
-
-	// Create frame transform filter
-	FrameTransformFilter *pFrameTransformFilter = NULL;
-	pFrameTransformFilter = new FrameTransformFilter(width, height);
-	if (!pFrameTransformFilter)
-		exit_message("Could not create frame transform filter", 1);
-	// NB Object will be automatically deleted when pTransform is released
-	hr = pFrameTransformFilter->QueryInterface(
-			IID_IBaseFilter, reinterpret_cast<void**>(&pTransform));
-	if (hr != S_OK)
-		exit_message("Could not get IBaseFilter interface of transform filter", 1);
-	
-	// Add transform filter to graph
-	hr = pGraph->AddFilter(pTransform, L"FrameTransform");
-	if (hr != S_OK)
-		exit_message("Could not add frame transform filter to filter graph", 1);
-	
-	// Create Null Renderer filter
-	hr = CoCreateInstance(CLSID_NullRenderer, NULL,
-		CLSCTX_INPROC_SERVER, IID_IBaseFilter,
-		(void**)&pNullRenderer);
-	if (hr != S_OK)
-		exit_message("Could not create Null Renderer filter", 1);
-	
-	// Add Null Renderer filter to filter graph
-	hr = pGraph->AddFilter(pNullRenderer, L"NullRender");
-	if (hr != S_OK)
-		exit_message("Could not add Null Renderer to filter graph", 1);
-	
-	// Try to set video resolution
-	hr = pBuilder->FindInterface(
-				&PIN_CATEGORY_CAPTURE,
-				&MEDIATYPE_Video,
-				pCap,
-				IID_IAMStreamConfig,
-				(void**)&pStreamConfig);
-	if (hr != S_OK)
-	{
-		fprintf(stderr, "Could not get IAMStreamConfig interface: ");
-		if (hr == E_FAIL) fprintf(stderr, "E_FAIL\n");
-		else if (hr == E_NOINTERFACE) fprintf(stderr, "E_NOINTERFACE\n");
-		else if (hr == E_POINTER) fprintf(stderr, "E_POINTER\n");
-	}
-	else
+	// Run graphs
+	for (n=0 ; n<number_cameras ; ++n)
 	{
-		// Successfully got the IAMStreamConfig interface
-		// Get, modify and set video format
-		AM_MEDIA_TYPE *pmt = 0;
-		hr = pStreamConfig->GetFormat(&pmt);
-		if (hr != S_OK)	exit_message("Error getting capture filter format", 1);
-		if (pmt->formattype != FORMAT_VideoInfo)
-			exit_message("AM_MEDIA_TYPE format type is not FORMAT_VideoInfo", 1);
-		VIDEOINFOHEADER *pvi = (VIDEOINFOHEADER *)pmt->pbFormat;
-		pvi->bmiHeader.biWidth = width;
-		pvi->bmiHeader.biHeight = height;
-		hr = pStreamConfig->SetFormat(pmt);
-		DeleteMediaType(pmt);
-	}
-
-	// Connect up the filter graph's preview stream
-	if (show_renderer)
-	{
-		hr = pBuilder->RenderStream(
-				&PIN_CATEGORY_CAPTURE, &MEDIATYPE_Video,
-				pCap, pTransform, NULL);
-	}
-	else
-	{
-		hr = pBuilder->RenderStream(
-				&PIN_CATEGORY_CAPTURE, &MEDIATYPE_Video,
-				pCap, pTransform, pNullRenderer);
-	}
-	if (hr != S_OK && hr != VFW_S_NOPREVIEWPIN)
-		exit_message("Could not render preview video stream", 1);
+		while(1)
+		{
+			hr = cameras[n].pMediaControl->Run();
 			
-	// Get media control interfaces to graph builder object
-	hr = pGraph->QueryInterface(IID_IMediaControl,
-					(void**)&pMediaControl);
-	if (hr != S_OK)
-		exit_message("Could not get media control interface", 1);
-	
-	// Run graph
-	while(1)
-	{
-		hr = pMediaControl->Run();
-		
-		// Hopefully, the return value was S_OK or S_FALSE
-		if (hr == S_OK) break; // graph is now running
-		if (hr == S_FALSE) continue; // graph still preparing to run
-		
-		// If the Run function returned something else,
-		// there must be a problem
-		fprintf(stderr, "Error: %u\n", hr);
-		exit_message("Could not run filter graph", 1);
+			// Hopefully, the return value was S_OK or S_FALSE
+			if (hr == S_OK) break; // graph is now running
+			if (hr == S_FALSE) continue; // graph still preparing to run
+			
+			// If the Run function returned something else,
+			// there must be a problem
+			fprintf(stderr, "Error: %u\n", hr);
+			exit_message("Could not run filter graph", 1);
+		}
 	}
 	
 	// A working message loop in the application thread
@@ -474,11 +667,19 @@ int main(int argc, char **argv)
 	// See the following link for more info:
 	// http://msdn.microsoft.com/en-us/library/windows/desktop/dd407349%28v=vs.85%29.aspx
 	//
+	// Each graph delivers frames to its transform filter on
+	// its own streaming thread, so this one thread only has
+	// to pump messages and request captures for all cameras.
+	//
 	MSG msg;
-	DWORD start_time = GetTickCount();
-	DWORD last_frame_time = start_time;
-	DWORD current_time = start_time;
-	if (run_command) pFrameTransformFilter->setCommand(command);
+	CaptureScheduler scheduler;
+	DWORD current_time;
+	for (n=0 ; n<number_cameras ; ++n)
+	{
+		s = &cameras[n].settings;
+		scheduler.addSource(s->delay, s->period);
+	}
+	scheduler.start(GetTickCount());
 	
 	// Message loop
 	while(1)
@@ -490,30 +691,51 @@ int main(int argc, char **argv)
 		// has elapsed.
 		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE) == 0)
 		{
-			// Exit if requested number of frames have been captured.
-			// If number of frames specified was less than zero, then
-			// continue capturing indefinitely.
-			if ((pFrameTransformFilter->filesSaved() >= frames) &&
-				(frames >= 0)) break;
-			
-			// Check if capture time has elapsed
 			current_time = GetTickCount();
-			if (current_time < start_time + delay) continue;
-			if (current_time < last_frame_time + period) continue;
 			
-			// Save next frame to PGM file
-			if (number_files)
+			// Camera is finished if requested number of frames have
+			// been captured. If number of frames specified was less
+			// than zero, then continue capturing indefinitely.
+			for (n=0 ; n<number_cameras ; ++n)
 			{
-				sprintf(filename, "frame%04d.%s",
-					pFrameTransformFilter->filesSaved() + 1,
-					filetype_string);
+				Camera *c = &cameras[n];
+				s = &c->settings;
+				if ((c->pFrameProcessor->filesSaved() >= s->frames) &&
+					(s->frames >= 0))
+				{
+					scheduler.finish(n);
+				}
 			}
-			else
+			
+			// Request a capture from every camera that is due
+			while ((n = scheduler.due(current_time)) >= 0)
 			{
-				sprintf(filename, "frame.%s", filetype_string);
+				Camera *c = &cameras[n];
+				s = &c->settings;
+				
+				// Save next frame to PGM file
+				if (number_cameras > 1) sprintf(label, "cam%d_", n+1);
+				else strcpy(label, "");
+				if (s->number_files)
+				{
+					sprintf(filename, "%sframe%04d.%s", label,
+						c->pFrameProcessor->filesSaved() + 1,
+						s->filetype_string);
+				}
+				else
+				{
+					sprintf(filename, "%sframe.%s", label, s->filetype_string);
+				}
+				c->pFrameProcessor->saveNextFrameToFile(filename);
 			}
-			pFrameTransformFilter->saveNextFrameToFile(filename);
-			last_frame_time = current_time;
+			
+			// Exit when every camera has finished
+			if (scheduler.running() == 0) break;
+			
+			// Sleep until the next capture is due or a message
+			// arrives, rather than spinning
+			MsgWaitForMultipleObjects(0, NULL, FALSE,
+				scheduler.waitTime(current_time, 10), QS_ALLINPUT);
 		}
 		else
 		{
@@ -523,12 +745,26 @@ int main(int argc, char **argv)
 			DispatchMessage(&msg);
 		}
 	}
-
-	// Stop the graph
-	hr = pMediaControl->Stop();
-	if (hr != S_OK) exit_message("Error stopping graph", 1);
-
+	
+	// Stop the graphs
+	for (n=0 ; n<number_cameras ; ++n)
+	{
+		hr = cameras[n].pMediaControl->Stop();
+		if (hr != S_OK) exit_message("Error stopping graph", 1);
+	}
+	
+	// Let the sinks write out the frames they still hold
+	for (n=0 ; n<number_cameras ; ++n)
+	{
+		cameras[n].pFrameProcessor->stopSinks();
+	}
+	
 	// Clean up and exit
+	for (n=0 ; n<number_cameras ; ++n)
+	{
+		cameras[n].pFrameProcessor->printStats();
+	}
+	delete pStereoPair;
 	fprintf(stderr, "Stopped capturing. Now exiting.");
 	exit_message("", 0);
 }
@@ -0,0 +1,321 @@
+//
+// RobotReplay.cpp - Run the RobotEyez processing stages on recorded frames
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Frames saved by RobotEyez (or by its sinks) are read back
+// from numbered PGM or BMP files and passed through the same
+// FrameProcessor as live frames, so the records printed are
+// the same as they would have been during capture. By
+// default frames are processed as fast as possible. If no
+// enabled stage depends on earlier frames, the frames are
+// shared between several threads, which finish them in any
+// order (each record carries its frame number).
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "ProcessingOptions.h"
+#include "ImageUtils.h"
+#include "Platform.h"
+
+// Replay settings
+char file_pattern[STRING_LENGTH] = "";
+int first_frame = 1;
+int number_frames = -1;
+double period = 1000;
+int realtime = 0;
+int threads = 0;
+char save_pattern[STRING_LENGTH] = "";
+int save_every = 1;
+ProcessingSettings settings;
+
+void exit_message(const char* error_message, int error)
+{
+	fputs(error_message, stderr);
+	fputs("\n", stderr);
+	exit(error);
+}
+
+//
+// Returns non-zero if the file can be opened for reading
+//
+int file_exists(char *filename)
+{
+	FILE *f = fopen(filename, "rb");
+	if (f == NULL) return 0;
+	fclose(f);
+	return 1;
+}
+
+int thread_number()
+{
+#ifdef _OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+//
+// Read recorded frame n (counting from 0) and run it through
+// the processor. Returns 0 on success or 1 if the frame
+// file could not be read.
+//
+int replay_frame(FrameProcessor *p, int n,
+	unsigned char *pIn, unsigned char *pOut, int w, int h)
+{
+	char filename[STRING_LENGTH + 20];
+	int frame_number = first_frame + n;
+	
+	sprintf(filename, file_pattern, frame_number);
+	if (read_frame_file(filename, pIn, w, h) != 0)
+	{
+		fprintf(stderr, "Could not read frame file %s\n", filename);
+		return 1;
+	}
+	
+	// Request a copy of every save_every'th frame
+	if (save_pattern[0] && (n + 1) % save_every == 0)
+	{
+		sprintf(filename, save_pattern, frame_number);
+		p->saveNextFrameToFile(filename);
+	}
+	
+	p->process(pIn, pOut, frame_number, n * period);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	char filename[STRING_LENGTH + 20];
+	const char *error;
+	int w, h, n;
+	
+	memset(&settings, 0, sizeof(settings));
+	
+	// Information message
+	fprintf(stderr, "\nRobotReplay.exe - http://batchloaf.wordpress.com\n\n");
+	
+	// Parse command line arguments. Available options:
+	//
+	//		/files FILENAME_PATTERN
+	//		/first FIRST_FRAME_NUMBER
+	//		/frames NUMBER_OF_FRAMES
+	//		/period PERIOD_IN_MILLISECONDS
+	//		/realtime
+	//		/threads NUMBER_OF_THREADS
+	//		/save FILENAME_PATTERN
+	//		/saveevery NUMBER_OF_FRAMES
+	//
+	// plus the processing options of RobotEyez (/track,
+	// /background, /stack, /undistort, /features, /markers,
+	// /stats, /sink etc - see ProcessingOptions.cpp).
+	//
+	// FILENAME_PATTERN contains %d or %04d etc for the frame
+	// number. The default is frame%04d.bmp, or frame%04d.pgm
+	// if there is no BMP file for the first frame. Frames are
+	// read until a file is missing unless /frames is given.
+	// /period is the time between the recorded frames, which
+	// is used to time sinks and, with /realtime, to replay
+	// the frames at the speed they were captured.
+	//
+	n = 1;
+	while (n < argc)
+	{
+		// Process next command line argument
+		if (strcmp(argv[n], "/files") == 0)
+		{
+			// Set pattern for recorded frame filenames
+			if (++n >= argc) exit_message("Error: invalid filename pattern specified", 1);
+			strncpy(file_pattern, argv[n], STRING_LENGTH - 1);
+			file_pattern[STRING_LENGTH - 1] = '\0';
+		}
+		else if (strcmp(argv[n], "/first") == 0)
+		{
+			// Set number of the first recorded frame
+			if (++n < argc) first_frame = atoi(argv[n]);
+			else exit_message("Error: invalid first frame specified", 1);
+		}
+		else if (strcmp(argv[n], "/frames") == 0)
+		{
+			// Set number of frames to replay
+			if (++n < argc) number_frames = atoi(argv[n]);
+			else exit_message("Error: invalid number of frames specified", 1);
+			
+			if (number_frames < 0)
+				exit_message("Error: invalid number of frames specified", 1);
+		}
+		else if (strcmp(argv[n], "/period") == 0)
+		{
+			// Set time between recorded frames
+			if (++n < argc) period = atof(argv[n]);
+			else exit_message("Error: invalid period specified", 1);
+			
+			if (period <= 0)
+				exit_message("Error: invalid period specified", 1);
+		}
+		else if (strcmp(argv[n], "/realtime") == 0)
+		{
+			// Set flag to replay frames at the recorded rate
+			realtime = 1;
+		}
+		else if (strcmp(argv[n], "/threads") == 0)
+		{
+			// Set number of threads for parallel replay
+			if (++n < argc) threads = atoi(argv[n]);
+			else exit_message("Error: invalid number of threads specified", 1);
+			
+			if (threads <= 0)
+				exit_message("Error: invalid number of threads specified", 1);
+		}
+		else if (strcmp(argv[n], "/save") == 0)
+		{
+			// Set pattern for filenames of saved frames
+			if (++n >= argc) exit_message("Error: invalid save filename pattern specified", 1);
+			strncpy(save_pattern, argv[n], STRING_LENGTH - 1);
+			save_pattern[STRING_LENGTH - 1] = '\0';
+		}
+		else if (strcmp(argv[n], "/saveevery") == 0)
+		{
+			// Set how often a frame is saved
+			if (++n < argc) save_every = atoi(argv[n]);
+			else exit_message("Error: invalid number of frames specified", 1);
+			
+			if (save_every <= 0)
+				exit_message("Error: invalid number of frames specified", 1);
+		}
+		else
+		{
+			// Processing stage options (see ProcessingOptions.cpp)
+			int result = parse_processing_option(argc, argv, &n, &settings, &error);
+			if (result < 0) exit_message(error, 1);
+			
+			if (result == 0)
+			{
+				// Unknown command line argument
+				fprintf(stderr, "Unrecognised option: %s\n", argv[n]);
+				exit_message("", 1);
+			}
+		}
+		
+		// Increment command line argument counter
+		n++;
+	}
+	
+	// Choose the default filename pattern
+	if (file_pattern[0] == '\0')
+	{
+		strcpy(file_pattern, "frame%04d.bmp");
+		sprintf(filename, file_pattern, first_frame);
+		if (!file_exists(filename)) strcpy(file_pattern, "frame%04d.pgm");
+	}
+	
+	// The frame size is taken from the first frame
+	sprintf(filename, file_pattern, first_frame);
+	if (read_image_size(filename, &w, &h) != 0)
+	{
+		fprintf(stderr, "Could not read frame file %s\n", filename);
+		exit_message("", 1);
+	}
+	
+	// Count the frames if the number wasn't specified
+	if (number_frames < 0)
+	{
+		number_frames = 0;
+		while (1)
+		{
+			sprintf(filename, file_pattern, first_frame + number_frames);
+			if (!file_exists(filename)) break;
+			number_frames++;
+		}
+	}
+	fprintf(stderr, "Replaying %d frames of %d x %d pixels\n", number_frames, w, h);
+	
+	// Create a processor (and frame buffers) for each thread
+#ifdef _OPENMP
+	if (threads > 0) omp_set_num_threads(threads);
+	int workers = omp_get_max_threads();
+#else
+	int workers = 1;
+#endif
+	FrameProcessor *processor = new FrameProcessor(w, h);
+	if (configure_processor(processor, &settings, "", &error) != 0)
+		exit_message(error, 1);
+	
+	// Stages which depend on earlier frames need the frames
+	// one at a time and in order
+	int sequential = realtime || workers == 1 || processor->isStateful();
+	if (sequential) workers = 1;
+	
+	FrameProcessor **processors = new FrameProcessor*[workers];
+	unsigned char **in_buffers = new unsigned char*[workers];
+	unsigned char **out_buffers = new unsigned char*[workers];
+	processors[0] = processor;
+	for (n=0 ; n<workers ; ++n)
+	{
+		if (n > 0)
+		{
+			processors[n] = new FrameProcessor(w, h);
+			if (configure_processor(processors[n], &settings, "", &error) != 0)
+				exit_message(error, 1);
+		}
+		in_buffers[n] = new unsigned char[3*w*h];
+		out_buffers[n] = new unsigned char[3*w*h];
+	}
+	
+	int failed = 0;
+	double start_time = get_time_ms();
+	if (sequential)
+	{
+		for (n=0 ; n<number_frames ; ++n)
+		{
+			// Wait until the frame is due if replaying in real time
+			if (realtime) sleep_ms(start_time + n * period - get_time_ms());
+			
+			failed += replay_frame(processor, n, in_buffers[0], out_buffers[0], w, h);
+		}
+	}
+	else
+	{
+		#pragma omp parallel for schedule(dynamic) reduction(+:failed)
+		for (n=0 ; n<number_frames ; ++n)
+		{
+			int t = thread_number();
+			failed += replay_frame(processors[t], n, in_buffers[t], out_buffers[t], w, h);
+		}
+	}
+	double replay_time = get_time_ms() - start_time;
+	
+	// Write out frames still queued for sinks
+	processor->stopSinks();
+	
+	// Print replay statistics
+	if (sequential) processor->printStats();
+	fprintf(stderr, "threads: %d\n", workers);
+	fprintf(stderr, "frames replayed: %d\n", number_frames - failed);
+	if (failed > 0) fprintf(stderr, "frames not read: %d\n", failed);
+	if (replay_time > 0)
+	{
+		double rate = 1000.0 * (number_frames - failed) / replay_time;
+		fprintf(stderr, "replay rate: %.1f frames/s (%.1f times real time)\n",
+			rate, rate * period / 1000.0);
+	}
+	
+	for (n=0 ; n<workers ; ++n)
+	{
+		delete processors[n];
+		delete [] in_buffers[n];
+		delete [] out_buffers[n];
+	}
+	delete [] processors;
+	delete [] in_buffers;
+	delete [] out_buffers;
+	
+	return failed > 0;
+}
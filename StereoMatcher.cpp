@@ -0,0 +1,259 @@
+//
+// StereoMatcher.cpp - StereoMatcher class
+//
+// Website: http://batchloaf.wordpress.com
+//
+// For each disparity d, the absolute differences between
+// left pixel (x,y) and right pixel (x-d,y) are summed down
+// each column of the block. These column sums are updated
+// incrementally as the block moves down the image, so
+// each output row only costs one row added and one row
+// removed per disparity, followed by a horizontal sum
+// of STEREO_BLOCK_SIZE columns.
+//
+// Each band of rows has its own buffers, so bands are
+// matched in parallel without sharing anything.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "StereoMatcher.h"
+#include "Platform.h"
+
+StereoMatcher::StereoMatcher()
+{
+	width = 0;
+	height = 0;
+	for (int b=0 ; b<STEREO_BANDS ; ++b)
+	{
+		column_sums[b] = NULL;
+		best_cost[b] = NULL;
+		best_disparity[b] = NULL;
+		block_cost[b] = NULL;
+	}
+}
+
+StereoMatcher::~StereoMatcher()
+{
+	for (int b=0 ; b<STEREO_BANDS ; ++b)
+	{
+		delete [] column_sums[b];
+		delete [] best_cost[b];
+		delete [] best_disparity[b];
+		delete [] block_cost[b];
+	}
+}
+
+int StereoMatcher::init(int w, int h, int number_disparities)
+{
+	if (number_disparities < 1 || number_disparities > 255) return 1;
+	if (w <= number_disparities + STEREO_BLOCK_SIZE || h <= STEREO_BLOCK_SIZE) return 1;
+	
+	width = w;
+	height = h;
+	num_disparities = number_disparities;
+	
+	for (int b=0 ; b<STEREO_BANDS ; ++b)
+	{
+		delete [] column_sums[b];
+		delete [] best_cost[b];
+		delete [] best_disparity[b];
+		delete [] block_cost[b];
+		column_sums[b] = new unsigned short[num_disparities * w];
+		best_cost[b] = new short[w];
+		best_disparity[b] = new short[w];
+		block_cost[b] = new short[w];
+	}
+	
+	return 0;
+}
+
+int StereoMatcher::disparities()
+{
+	return num_disparities;
+}
+
+void StereoMatcher::compute(unsigned char *pLeft, unsigned char *pRight, unsigned char *disparity)
+{
+	int R = STEREO_BLOCK_SIZE / 2;
+	int b;
+	
+	// Rows too close to the top and bottom have no disparity
+	memset(disparity, 0, R*width);
+	memset(disparity + (height-R)*width, 0, R*width);
+	
+	#pragma omp parallel for schedule(dynamic)
+	for (b=0 ; b<STEREO_BANDS ; ++b)
+	{
+		matchBand(b, pLeft, pRight, disparity);
+	}
+}
+
+//
+// Add (sign = 1) or subtract (sign = -1) the absolute
+// differences of one image row to the column sums
+//
+static void accumulate_row(unsigned short *sums, unsigned char *left,
+	unsigned char *right, int w, int d, int sign)
+{
+	int x = d;
+	
+#ifdef USE_SSE2
+	__m128i zero = _mm_setzero_si128();
+	for ( ; x+16<=w ; x+=16)
+	{
+		__m128i l = _mm_loadu_si128((__m128i *)(left + x));
+		__m128i r = _mm_loadu_si128((__m128i *)(right + x - d));
+		__m128i ad = _mm_or_si128(_mm_subs_epu8(l, r), _mm_subs_epu8(r, l));
+		__m128i s0 = _mm_loadu_si128((__m128i *)(sums + x));
+		__m128i s1 = _mm_loadu_si128((__m128i *)(sums + x + 8));
+		if (sign > 0)
+		{
+			s0 = _mm_add_epi16(s0, _mm_unpacklo_epi8(ad, zero));
+			s1 = _mm_add_epi16(s1, _mm_unpackhi_epi8(ad, zero));
+		}
+		else
+		{
+			s0 = _mm_sub_epi16(s0, _mm_unpacklo_epi8(ad, zero));
+			s1 = _mm_sub_epi16(s1, _mm_unpackhi_epi8(ad, zero));
+		}
+		_mm_storeu_si128((__m128i *)(sums + x), s0);
+		_mm_storeu_si128((__m128i *)(sums + x + 8), s1);
+	}
+#endif
+	
+	for ( ; x<w ; ++x)
+	{
+		int ad = abs(left[x] - right[x-d]);
+		sums[x] = (unsigned short)(sums[x] + sign * ad);
+	}
+}
+
+void StereoMatcher::matchBand(int band, unsigned char *pLeft, unsigned char *pRight, unsigned char *disparity)
+{
+	int R = STEREO_BLOCK_SIZE / 2;
+	int rows = height - 2*R;
+	int y0 = R + (band * rows) / STEREO_BANDS;
+	int y1 = R + ((band + 1) * rows) / STEREO_BANDS;
+	int x_start = num_disparities - 1 + R;	// first column with a full search range
+	int x_end = width - R;
+	int x, y, d, j;
+	
+	unsigned short *sums = column_sums[band];
+	short *best = best_cost[band];
+	short *best_d = best_disparity[band];
+	short *cost = block_cost[band];
+	
+	if (y0 >= y1) return;
+	
+	// Column sums for the block around the first row of the band
+	memset(sums, 0, num_disparities * width * sizeof(unsigned short));
+	for (d=0 ; d<num_disparities ; ++d)
+	{
+		for (j=y0-R ; j<=y0+R ; ++j)
+		{
+			accumulate_row(sums + d*width, pLeft + j*width, pRight + j*width, width, d, 1);
+		}
+	}
+	
+	for (y=y0 ; y<y1 ; ++y)
+	{
+		// Slide the block down one row
+		if (y > y0)
+		{
+			for (d=0 ; d<num_disparities ; ++d)
+			{
+				accumulate_row(sums + d*width, pLeft + (y+R)*width,
+					pRight + (y+R)*width, width, d, 1);
+				accumulate_row(sums + d*width, pLeft + (y-R-1)*width,
+					pRight + (y-R-1)*width, width, d, -1);
+			}
+		}
+		
+		for (x=x_start ; x<x_end ; ++x)
+		{
+			best[x] = 32767;
+			best_d[x] = 0;
+		}
+		
+		for (d=0 ; d<num_disparities ; ++d)
+		{
+			unsigned short *s = sums + d*width;
+			x = x_start;
+			
+#ifdef USE_SSE2
+			__m128i vd = _mm_set1_epi16((short)d);
+			for ( ; x+8<=x_end ; x+=8)
+			{
+				// Horizontal sum of the block's column sums
+				__m128i c = _mm_loadu_si128((__m128i *)(s + x - R));
+				for (j=-R+1 ; j<=R ; ++j)
+				{
+					c = _mm_add_epi16(c, _mm_loadu_si128((__m128i *)(s + x + j)));
+				}
+				
+				// Keep the lowest cost and its disparity
+				__m128i b = _mm_loadu_si128((__m128i *)(best + x));
+				__m128i bd = _mm_loadu_si128((__m128i *)(best_d + x));
+				__m128i better = _mm_cmplt_epi16(c, b);
+				_mm_storeu_si128((__m128i *)(best + x), _mm_min_epi16(c, b));
+				_mm_storeu_si128((__m128i *)(best_d + x), _mm_or_si128(
+					_mm_and_si128(better, vd), _mm_andnot_si128(better, bd)));
+			}
+#endif
+			
+			for ( ; x<x_end ; ++x)
+			{
+				int c = 0;
+				for (j=-R ; j<=R ; ++j) c += s[x+j];
+				cost[x] = (short)c;
+				if (cost[x] < best[x])
+				{
+					best[x] = cost[x];
+					best_d[x] = (short)d;
+				}
+			}
+		}
+		
+		unsigned char *out = disparity + y*width;
+		memset(out, 0, x_start);
+		for (x=x_start ; x<x_end ; ++x) out[x] = (unsigned char)best_d[x];
+		memset(out + x_end, 0, width - x_end);
+	}
+}
+
+void StereoMatcher::obstacles(unsigned char *disparity, int *strip_disparities)
+{
+	int histogram[256];
+	int strip, x, y, d, total, count;
+	
+	for (strip=0 ; strip<STEREO_STRIPS ; ++strip)
+	{
+		int x0 = (strip * width) / STEREO_STRIPS;
+		int x1 = ((strip + 1) * width) / STEREO_STRIPS;
+		
+		memset(histogram, 0, sizeof(histogram));
+		for (y=0 ; y<height ; ++y)
+		{
+			unsigned char *p = disparity + y*width;
+			for (x=x0 ; x<x1 ; ++x) histogram[p[x]]++;
+		}
+		
+		// Zero disparity is treated as invalid (or very distant)
+		total = 0;
+		for (d=1 ; d<num_disparities ; ++d) total += histogram[d];
+		
+		strip_disparities[strip] = 0;
+		count = 0;
+		for (d=num_disparities-1 ; d>0 ; --d)
+		{
+			count += histogram[d];
+			if (total > 0 && 100 * count >= STEREO_OBSTACLE_PERCENT * total)
+			{
+				strip_disparities[strip] = d;
+				break;
+			}
+		}
+	}
+}
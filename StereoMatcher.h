@@ -0,0 +1,61 @@
+//
+// StereoMatcher.h - StereoMatcher header file
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef STEREOMATCHER_H
+#define STEREOMATCHER_H
+
+// Default number of disparities searched
+#define STEREO_DISPARITIES 64
+
+// Block size for SAD matching (odd, at most 11 so that
+// the block cost always fits in a signed 16-bit value)
+#define STEREO_BLOCK_SIZE 9
+
+// Rows are split into this many bands, which are matched in parallel
+#define STEREO_BANDS 8
+
+// The obstacle summary splits the image into this many vertical strips
+#define STEREO_STRIPS 8
+
+// A strip's obstacle disparity is the largest disparity that at
+// least this percentage of its valid pixels reach
+#define STEREO_OBSTACLE_PERCENT 2
+
+// Computes a disparity map from a rectified pair of grey
+// images using sum of absolute differences block matching
+class StereoMatcher
+{
+public:
+	StereoMatcher();
+	~StereoMatcher();
+	
+	// Allocate buffers for w x h images
+	int init(int w, int h, int number_disparities);
+	
+	// Match a rectified pair of top-down grey images. For every
+	// pixel of the left image, disparity receives the offset
+	// (in pixels) of the best match in the right image, or 0
+	// where no disparity could be computed.
+	void compute(unsigned char *pLeft, unsigned char *pRight, unsigned char *disparity);
+	
+	// Summarise a disparity map as the nearest obstacle
+	// disparity in each of STEREO_STRIPS vertical strips
+	void obstacles(unsigned char *disparity, int *strip_disparities);
+	
+	int disparities();
+	
+private:
+	int width, height;
+	int num_disparities;
+	unsigned short *column_sums[STEREO_BANDS];	// per band: num_disparities rows of width
+	short *best_cost[STEREO_BANDS];	// per band: best cost for each pixel of a row
+	short *best_disparity[STEREO_BANDS];	// per band: best disparity for each pixel of a row
+	short *block_cost[STEREO_BANDS];	// per band: block cost for one disparity
+	
+	void matchBand(int band, unsigned char *pLeft, unsigned char *pRight, unsigned char *disparity);
+};
+
+#endif // STEREOMATCHER_H
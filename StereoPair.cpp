@@ -0,0 +1,138 @@
+//
+// StereoPair.cpp - StereoPair class
+//
+// Website: http://batchloaf.wordpress.com
+//
+// The lock is only held while a frame is copied in and
+// buffer pointers are swapped, never while a pair is
+// being matched, so one camera's streaming thread is
+// never held up by block matching on the other's. If a
+// pair arrives while the previous one is still being
+// matched it is simply dropped.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "StereoPair.h"
+#include "ImageUtils.h"
+
+StereoPair::StereoPair()
+{
+	width = 0;
+	height = 0;
+	busy = 0;
+	pairs = 0;
+	save_disparity = 0;
+	disparity = NULL;
+	for (int n=0 ; n<2 ; ++n)
+	{
+		latest[n] = NULL;
+		matching[n] = NULL;
+		latest_valid[n] = 0;
+	}
+}
+
+StereoPair::~StereoPair()
+{
+	for (int n=0 ; n<2 ; ++n)
+	{
+		delete [] latest[n];
+		delete [] matching[n];
+	}
+	delete [] disparity;
+}
+
+int StereoPair::init(int w, int h, int number_disparities, double tolerance_ms)
+{
+	if (matcher.init(w, h, number_disparities) != 0) return 1;
+	
+	width = w;
+	height = h;
+	tolerance = tolerance_ms;
+	for (int n=0 ; n<2 ; ++n)
+	{
+		latest[n] = new unsigned char[w*h];
+		matching[n] = new unsigned char[w*h];
+	}
+	disparity = new unsigned char[w*h];
+	
+	return 0;
+}
+
+int StereoPair::submit(int side, unsigned char *pGrey, double time, StereoResult *result)
+{
+	unsigned char *swap;
+	double start_time;
+	int other = 1 - side;
+	int paired = 0;
+	
+	mutex.lock();
+	memcpy(latest[side], pGrey, width*height);
+	latest_time[side] = time;
+	latest_valid[side] = 1;
+	
+	// Take both frames if they are close enough in time
+	if (!busy && latest_valid[other] && fabs(time - latest_time[other]) <= tolerance)
+	{
+		for (int n=0 ; n<2 ; ++n)
+		{
+			swap = matching[n];
+			matching[n] = latest[n];
+			latest[n] = swap;
+			latest_valid[n] = 0;
+		}
+		result->skew = latest_time[STEREO_LEFT] - latest_time[STEREO_RIGHT];
+		result->pair_number = ++pairs;
+		busy = 1;
+		paired = 1;
+	}
+	mutex.unlock();
+	
+	if (!paired) return 0;
+	
+	start_time = get_time_ms();
+	matcher.compute(matching[STEREO_LEFT], matching[STEREO_RIGHT], disparity);
+	matcher.obstacles(disparity, result->strip_disparities);
+	result->match_time = get_time_ms() - start_time;
+	
+	// Save the disparity map if requested, scaled to fill the
+	// grey range. The matching buffers are still ours until
+	// busy is cleared, so the file is written without the lock.
+	char save_filename[200];
+	int save = 0;
+	mutex.lock();
+	if (save_disparity)
+	{
+		strcpy(save_filename, filename);
+		save_disparity = 0;
+		save = 1;
+	}
+	mutex.unlock();
+	
+	if (save)
+	{
+		int scale = (matcher.disparities() > 1) ? matcher.disparities() - 1 : 1;
+		for (int n=0 ; n<width*height ; ++n)
+		{
+			matching[STEREO_LEFT][n] = (unsigned char)((disparity[n] * 255) / scale);
+		}
+		write_grey_pgm_file(save_filename, matching[STEREO_LEFT], width, height);
+	}
+	
+	mutex.lock();
+	busy = 0;
+	mutex.unlock();
+	
+	return 1;
+}
+
+void StereoPair::saveNextDisparity(char *disparity_filename)
+{
+	mutex.lock();
+	strncpy(filename, disparity_filename, sizeof(filename) - 1);
+	filename[sizeof(filename) - 1] = '\0';
+	save_disparity = 1;
+	mutex.unlock();
+}
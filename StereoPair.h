@@ -0,0 +1,66 @@
+//
+// StereoPair.h - StereoPair header file
+//
+// Website: http://batchloaf.wordpress.com
+//
+
+#ifndef STEREOPAIR_H
+#define STEREOPAIR_H
+
+#include "StereoMatcher.h"
+#include "Platform.h"
+
+// Default tolerance for pairing left and right frames (ms)
+#define STEREO_TOLERANCE 10.0
+
+#define STEREO_LEFT 0
+#define STEREO_RIGHT 1
+
+// Result for one matched stereo pair
+struct StereoResult
+{
+	int pair_number;	// number of pairs matched so far
+	double skew;	// left frame time minus right frame time (ms)
+	double match_time;	// time taken by block matching (ms)
+	int strip_disparities[STEREO_STRIPS];	// nearest obstacle in each strip
+};
+
+// Pairs the grey frames from two cameras by timestamp and
+// computes the disparity of each pair. It is shared by the
+// transform filters of both cameras, which call submit from
+// their own streaming threads.
+class StereoPair
+{
+public:
+	StereoPair();
+	~StereoPair();
+	
+	int init(int w, int h, int number_disparities, double tolerance_ms);
+	
+	// Offer the latest grey frame from one side (STEREO_LEFT
+	// or STEREO_RIGHT) with its timestamp in ms. If it pairs
+	// with the latest frame from the other side, the pair is
+	// matched on the calling thread and 1 is returned with
+	// the result filled in. Otherwise 0 is returned at once.
+	int submit(int side, unsigned char *pGrey, double time, StereoResult *result);
+	
+	// Save the disparity map of the next pair to a PGM file
+	void saveNextDisparity(char *filename);
+	
+private:
+	int width, height;
+	double tolerance;
+	Mutex mutex;	// protects everything below
+	unsigned char *latest[2];	// latest frame from each side
+	double latest_time[2];
+	int latest_valid[2];
+	unsigned char *matching[2];	// pair currently being matched
+	unsigned char *disparity;
+	int busy;	// set while a pair is being matched
+	int pairs;
+	int save_disparity;
+	char filename[200];
+	StereoMatcher matcher;
+};
+
+#endif // STEREOPAIR_H
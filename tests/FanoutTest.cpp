@@ -0,0 +1,172 @@
+//
+// FanoutTest.cpp - Stress test of FrameFanout with slow sinks
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Submits a few hundred frames to sinks which range from
+// writing a file as fast as possible to sleeping for 300 ms
+// per frame in their command, with different regions,
+// pyramid levels, queue lengths and drop policies. Checks
+// that every frame a sink accepted was either written or
+// dropped, that every pool buffer is back in the pool after
+// stop, and that submit never waits for a slow sink.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FrameFanout.h"
+#include "Platform.h"
+
+#define TEST_WIDTH 320
+#define TEST_HEIGHT 240
+#define TEST_FRAMES 300
+
+// Longest submit allowed. The quickest slow sink takes 100 ms
+// per frame, so waiting for any sink would exceed this.
+#define MAX_SUBMIT_MS 50
+
+// A synthetic sink: its speed is set by its command
+struct TestSink
+{
+	const char *pattern;
+	const char *command;
+	double period;
+	int queue_length;
+	int drop_policy;
+	OutputRegion region;
+};
+
+TestSink test_sinks[] = {
+	// Whole frame as quickly as possible, twice (shared copy)
+	{"fanout_fast.pgm", "", 0, 4, SINK_DROP_OLDEST, {0, 0, 0, 0, 0}},
+	{"fanout_fast.bmp", "true", 0, 4, SINK_DROP_OLDEST, {0, 0, 0, 0, 0}},
+	// Half size frame at 10 fps
+	{"fanout_slow.pgm", "sleep 0.1;true", 0, 2, SINK_DROP_OLDEST, {0, 0, 0, 0, 1}},
+	// Region of interest at 3 fps, keeping the oldest frames
+	{"fanout_slower.bmp", "sleep 0.3;true", 0, 4, SINK_DROP_NEWEST, {40, 30, 100, 80, 0}},
+	// Rate limited quarter size frame
+	{"fanout_limited.pgm", "", 30, 3, SINK_DROP_OLDEST, {0, 0, 0, 0, 2}},
+};
+int number_sinks = sizeof(test_sinks) / sizeof(test_sinks[0]);
+
+//
+// Run one stress test, submitting a frame every interval ms
+// (or as quickly as possible if 0). Returns the number of
+// failed checks.
+//
+int run_test(const char *name, double interval, unsigned char *pFrame)
+{
+	FrameFanout fanout;
+	ImagePyramid pyramid;
+	int n, failures = 0;
+	double submit_time, max_submit_time = 0, total_submit_time = 0;
+	int accepted, written, dropped;
+	
+	for (n=0 ; n<number_sinks ; ++n)
+	{
+		TestSink *t = &test_sinks[n];
+		if (fanout.addSink((char *)t->pattern, t->period, t->queue_length,
+				t->drop_policy, (char *)t->command, &t->region) != 0)
+		{
+			fprintf(stderr, "  %s: could not add sink %s\n", name, t->pattern);
+			return 1;
+		}
+	}
+	pyramid.initBGR(TEST_WIDTH, TEST_HEIGHT, 3);
+	if (fanout.start(TEST_WIDTH, TEST_HEIGHT) != 0)
+	{
+		fprintf(stderr, "  %s: could not start sinks\n", name);
+		return 1;
+	}
+	
+	double start_time = get_time_ms();
+	for (int frame=0 ; frame<TEST_FRAMES ; ++frame)
+	{
+		if (interval > 0) sleep_ms(start_time + frame * interval - get_time_ms());
+		
+		// Submit the frame as FrameProcessor does
+		double frame_time = get_time_ms() - start_time;
+		submit_time = get_time_ms();
+		int levels = fanout.levelsDue(frame_time);
+		if (levels > 0)
+		{
+			pFrame[0] = (unsigned char)frame;
+			pyramid.build(pFrame, levels);
+			fanout.submit(&pyramid, frame + 1, frame_time);
+		}
+		submit_time = get_time_ms() - submit_time;
+		
+		total_submit_time += submit_time;
+		if (submit_time > max_submit_time) max_submit_time = submit_time;
+	}
+	double submitted_time = get_time_ms() - start_time;
+	
+	fanout.stop();
+	
+	printf("%s: %d frames submitted in %.0f ms, %.3f ms/frame, longest %.3f ms\n",
+		name, TEST_FRAMES, submitted_time, total_submit_time / TEST_FRAMES, max_submit_time);
+	fanout.printStats((char *)"  ");
+	
+	// Every frame accepted was written or dropped
+	for (n=0 ; n<number_sinks ; ++n)
+	{
+		fanout.sinkCounts(n, &accepted, &written, &dropped);
+		if (accepted == 0 || accepted != written + dropped)
+		{
+			fprintf(stderr, "  %s: sink %s accepted %d frames, wrote %d and dropped %d\n",
+				name, test_sinks[n].pattern, accepted, written, dropped);
+			failures++;
+		}
+	}
+	
+	// The slowest sink must have fallen behind, or the test
+	// hasn't tested anything
+	fanout.sinkCounts(3, &accepted, &written, &dropped);
+	if (dropped == 0)
+	{
+		fprintf(stderr, "  %s: the slowest sink dropped no frames\n", name);
+		failures++;
+	}
+	
+	// No buffers are lost from the pool
+	if (fanout.framesInUse() != 0)
+	{
+		fprintf(stderr, "  %s: %d pool buffers not returned after stop\n",
+			name, fanout.framesInUse());
+		failures++;
+	}
+	
+	// submit doesn't wait for the sinks
+	if (max_submit_time > MAX_SUBMIT_MS)
+	{
+		fprintf(stderr, "  %s: submit took %.1f ms\n", name, max_submit_time);
+		failures++;
+	}
+	
+	return failures;
+}
+
+int main()
+{
+	int failures = 0;
+	unsigned char *pFrame = new unsigned char[3*TEST_WIDTH*TEST_HEIGHT];
+	
+	for (int i=0 ; i<3*TEST_WIDTH*TEST_HEIGHT ; ++i) pFrame[i] = (unsigned char)(i * 7);
+	
+	printf("FrameFanout stress test\n");
+	failures += run_test("paced", 4, pFrame);
+	failures += run_test("burst", 0, pFrame);
+	
+	for (int n=0 ; n<number_sinks ; ++n) remove(test_sinks[n].pattern);
+	delete [] pFrame;
+	
+	if (failures > 0)
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("passed\n");
+	return 0;
+}
@@ -0,0 +1,222 @@
+//
+// MarkerTest.cpp - Test of MarkerDetector on synthetic frames
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Renders 200 640x480 frames, each holding one marker with a
+// random id seen from a random position, size, rotation and
+// tilt, with a little noise. The marker is supersampled so
+// its edges are anti-aliased as in a camera image. Checks that
+// every marker is found with the right id and no false ones,
+// and that the corners are found to within a fraction of a
+// pixel. Corners are measured with the centre of the top-left
+// pixel at (0,0), as MarkerDetector reports them.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "MarkerDetector.h"
+#include "Platform.h"
+
+#define TEST_WIDTH 640
+#define TEST_HEIGHT 480
+#define TEST_FRAMES 200
+
+// Grey levels of the marker's cells and some noise
+#define BLACK 30
+#define WHITE 220
+#define NOISE 4
+
+// Samples per pixel in each direction
+#define SUPERSAMPLING 4
+
+// Largest mean and single corner errors allowed (pixels)
+#define MAX_MEAN_ERROR 0.25
+#define MAX_CORNER_ERROR 1.0
+
+// Each row of the marker holds one of these codewords, as
+// in MarkerDetector
+static const int row_codes[4] = {0x10, 0x17, 0x09, 0x0e};
+
+double random_range(double low, double high)
+{
+	return low + (high - low) * rand() / RAND_MAX;
+}
+
+//
+// Perspective mapping of the unit square onto the corners
+// (qx, qy) as a 3x3 matrix m, so that (u,v) maps to
+// ((m0 u + m1 v + m2) / (m6 u + m7 v + 1), (m3 u + m4 v + m5) / (...))
+//
+void square_to_quad(double *qx, double *qy, double *m)
+{
+	double sx = qx[0] - qx[1] + qx[2] - qx[3];
+	double sy = qy[0] - qy[1] + qy[2] - qy[3];
+	double dx1 = qx[1] - qx[2], dx2 = qx[3] - qx[2];
+	double dy1 = qy[1] - qy[2], dy2 = qy[3] - qy[2];
+	double den = dx1*dy2 - dx2*dy1;
+	double g = (sx*dy2 - dx2*sy) / den;
+	double h = (dx1*sy - sx*dy1) / den;
+	
+	m[0] = qx[1] - qx[0] + g*qx[1];
+	m[1] = qx[3] - qx[0] + h*qx[3];
+	m[2] = qx[0];
+	m[3] = qy[1] - qy[0] + g*qy[1];
+	m[4] = qy[3] - qy[0] + h*qy[3];
+	m[5] = qy[0];
+	m[6] = g;
+	m[7] = h;
+	m[8] = 1;
+}
+
+//
+// Inverse of a 3x3 matrix (up to scale)
+//
+void invert(double *m, double *inverse)
+{
+	inverse[0] = m[4]*m[8] - m[5]*m[7];
+	inverse[1] = m[2]*m[7] - m[1]*m[8];
+	inverse[2] = m[1]*m[5] - m[2]*m[4];
+	inverse[3] = m[5]*m[6] - m[3]*m[8];
+	inverse[4] = m[0]*m[8] - m[2]*m[6];
+	inverse[5] = m[2]*m[3] - m[0]*m[5];
+	inverse[6] = m[3]*m[7] - m[4]*m[6];
+	inverse[7] = m[1]*m[6] - m[0]*m[7];
+	inverse[8] = m[0]*m[4] - m[1]*m[3];
+}
+
+//
+// Colour of the marker with the given id at (u,v) on the
+// unit square, with a white quiet zone around it
+//
+int marker_value(int id, double u, double v)
+{
+	if (u < 0 || v < 0 || u >= 1 || v >= 1) return WHITE;
+	
+	int x = (int)(u * 7), y = (int)(v * 7);
+	if (x == 0 || y == 0 || x == 6 || y == 6) return BLACK;
+	
+	int code = row_codes[(id >> (2*(5-y))) & 3];
+	return ((code >> (5-x)) & 1) ? WHITE : BLACK;
+}
+
+//
+// Render a marker whose corners (clockwise from its top-left)
+// are at (qx, qy)
+//
+void render(unsigned char *pGrey, int id, double *qx, double *qy)
+{
+	double m[9], inverse[9];
+	int x, y, i, j;
+	
+	square_to_quad(qx, qy, m);
+	invert(m, inverse);
+	
+	for (y=0 ; y<TEST_HEIGHT ; ++y)
+	{
+		for (x=0 ; x<TEST_WIDTH ; ++x)
+		{
+			// Pixel (x,y) covers x-0.5 to x+0.5
+			int sum = 0;
+			for (j=0 ; j<SUPERSAMPLING ; ++j)
+			{
+				for (i=0 ; i<SUPERSAMPLING ; ++i)
+				{
+					double px = x - 0.5 + (i + 0.5) / SUPERSAMPLING;
+					double py = y - 0.5 + (j + 0.5) / SUPERSAMPLING;
+					double w = inverse[6]*px + inverse[7]*py + inverse[8];
+					double u = (inverse[0]*px + inverse[1]*py + inverse[2]) / w;
+					double v = (inverse[3]*px + inverse[4]*py + inverse[5]) / w;
+					sum += marker_value(id, u, v);
+				}
+			}
+			int value = sum / (SUPERSAMPLING * SUPERSAMPLING) + rand() % (2*NOISE + 1) - NOISE;
+			pGrey[y*TEST_WIDTH + x] = (unsigned char)(value < 0 ? 0 : value > 255 ? 255 : value);
+		}
+	}
+}
+
+int main()
+{
+	unsigned char *pGrey = new unsigned char[TEST_WIDTH * TEST_HEIGHT];
+	MarkerDetector detector;
+	double qx[4], qy[4];
+	int frame, k, found = 0, false_markers = 0, failures = 0;
+	double total_error = 0, max_error = 0, total_time = 0;
+	
+	printf("MarkerDetector test\n");
+	srand(1);
+	detector.init(TEST_WIDTH, TEST_HEIGHT);
+	
+	for (frame=0 ; frame<TEST_FRAMES ; ++frame)
+	{
+		// A square of random size and rotation, with each
+		// corner moved a little to tilt it
+		int id = rand() % 1024;
+		double side = random_range(60, 180);
+		double angle = random_range(0, 2*M_PI);
+		double cx = random_range(side, TEST_WIDTH - side);
+		double cy = random_range(side, TEST_HEIGHT - side);
+		for (k=0 ; k<4 ; ++k)
+		{
+			double a = angle + k * M_PI/2 - 3*M_PI/4;
+			qx[k] = cx + side * M_SQRT1_2 * cos(a) + random_range(-0.1, 0.1) * side;
+			qy[k] = cy + side * M_SQRT1_2 * sin(a) + random_range(-0.1, 0.1) * side;
+		}
+		render(pGrey, id, qx, qy);
+		
+		double start_time = get_time_ms();
+		int number_markers = detector.process(pGrey);
+		total_time += get_time_ms() - start_time;
+		
+		Marker *markers = detector.markers();
+		for (int n=0 ; n<number_markers ; ++n)
+		{
+			if (markers[n].id != id)
+			{
+				false_markers++;
+				continue;
+			}
+			found++;
+			for (k=0 ; k<4 ; ++k)
+			{
+				double error = sqrt(pow(markers[n].x[k] - qx[k], 2) + pow(markers[n].y[k] - qy[k], 2));
+				total_error += error;
+				if (error > max_error) max_error = error;
+			}
+		}
+	}
+	
+	double mean_error = (found > 0) ? total_error / (4*found) : 0;
+	printf("%dx%d: %.2f ms/frame\n", TEST_WIDTH, TEST_HEIGHT, total_time / TEST_FRAMES);
+	printf("%d of %d markers found, %d false, corner error mean %.3f max %.3f pixels\n",
+		found, TEST_FRAMES, false_markers, mean_error, max_error);
+	
+	if (found != TEST_FRAMES)
+	{
+		fprintf(stderr, "  %d markers were not found\n", TEST_FRAMES - found);
+		failures++;
+	}
+	if (false_markers > 0)
+	{
+		fprintf(stderr, "  %d false markers were found\n", false_markers);
+		failures++;
+	}
+	if (mean_error > MAX_MEAN_ERROR || max_error > MAX_CORNER_ERROR)
+	{
+		fprintf(stderr, "  corners are too far from the true positions\n");
+		failures++;
+	}
+	
+	delete [] pGrey;
+	
+	if (failures > 0)
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("passed\n");
+	return 0;
+}
@@ -0,0 +1,350 @@
+//
+// MultiCameraTest.cpp - Test of several cameras in one process
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Runs three synthetic cameras of different sizes and frame
+// rates, each on its own thread with its own FrameProcessor
+// and label, as RobotEyez does with DirectShow's streaming
+// threads. The main thread requests captures with a
+// CaptureScheduler like the RobotEyez message loop. Checks
+// that every camera saved its own frames at its own size, that
+// every record line belongs to one camera, and that each
+// camera's features and stats records are the same as when
+// its frames are processed on their own.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FrameProcessor.h"
+#include "CaptureScheduler.h"
+#include "Platform.h"
+
+#define TEST_FRAMES 60
+#define TEST_FEATURES 100
+#define MAX_TEST_MS 10000
+
+#define RECORDS_FILENAME "multicamera_records.txt"
+#define SOLO_RECORDS_FILENAME "multicamera_solo.txt"
+
+// A synthetic camera
+struct SyntheticCamera
+{
+	int width, height;
+	int frame_interval;	// time between frames (ms)
+	int delay, period, frames;	// capture settings as in RobotEyez
+	char label[20];
+	FrameProcessor *processor;
+	int paced;	// deliver frames in real time rather than at once
+};
+
+SyntheticCamera cameras[] = {
+	{320, 240, 20, 100, 200, 3, "cam1 ", NULL, 0},
+	{256, 192, 15, 50, 150, 4, "cam2 ", NULL, 0},
+	{160, 120, 30, 200, 300, 2, "cam3 ", NULL, 0},
+};
+int number_cameras = sizeof(cameras) / sizeof(cameras[0]);
+Thread threads[sizeof(cameras) / sizeof(cameras[0])];
+
+//
+// Pseudo-random texture, different for each camera and moving
+// one pixel to the right every frame
+//
+int texture(int camera, int x, int y, int frame)
+{
+	unsigned int h = (unsigned int)((x - frame)/2 * 73856093) ^ (unsigned int)(y/2 * 19349663) ^
+		(unsigned int)(camera * 83492791);
+	h ^= h >> 13;
+	h *= 0x5bd1e995;
+	h ^= h >> 15;
+	return h & 0xff;
+}
+
+//
+// Camera thread: deliver every frame to the camera's
+// FrameProcessor
+//
+void camera_thread(void *argument)
+{
+	SyntheticCamera *c = (SyntheticCamera *)argument;
+	int n = (int)(c - cameras);
+	unsigned char *pIn = new unsigned char[3 * c->width * c->height];
+	unsigned char *pOut = new unsigned char[3 * c->width * c->height];
+	double start_time = get_time_ms();
+	
+	for (int frame=1 ; frame<=TEST_FRAMES ; ++frame)
+	{
+		if (c->paced) sleep_ms(start_time + frame * c->frame_interval - get_time_ms());
+		
+		// Bottom-up BGR, like DirectShow
+		for (int y=0 ; y<c->height ; ++y)
+		{
+			unsigned char *p = pIn + 3 * (c->height - 1 - y) * c->width;
+			for (int x=0 ; x<c->width ; ++x)
+			{
+				int v = texture(n, x, y, frame);
+				p[3*x] = (unsigned char)v;
+				p[3*x + 1] = (unsigned char)(v / 2 + 64);
+				p[3*x + 2] = (unsigned char)(255 - v);
+			}
+		}
+		c->processor->process(pIn, pOut, frame, frame * c->frame_interval);
+	}
+	
+	delete [] pIn;
+	delete [] pOut;
+}
+
+//
+// Create each camera's FrameProcessor with the stages whose
+// records are checked
+//
+void create_processors()
+{
+	for (int n=0 ; n<number_cameras ; ++n)
+	{
+		SyntheticCamera *c = &cameras[n];
+		c->processor = new FrameProcessor(c->width, c->height);
+		c->processor->setLabel(c->label);
+		c->processor->enableFeatureTracking(TEST_FEATURES);
+		c->processor->enableStats(STATS_FRAME);
+	}
+}
+
+void delete_processors()
+{
+	for (int n=0 ; n<number_cameras ; ++n)
+	{
+		delete cameras[n].processor;
+		cameras[n].processor = NULL;
+	}
+}
+
+//
+// Send stdout (where the records are printed) to a file,
+// or back to where it was if filename is NULL
+//
+void redirect_stdout(const char *filename)
+{
+	static int saved_stdout = -1;
+	
+	fflush(stdout);
+	if (filename)
+	{
+		saved_stdout = dup(fileno(stdout));
+		if (freopen(filename, "w", stdout) == NULL) exit(1);
+	}
+	else
+	{
+		dup2(saved_stdout, fileno(stdout));
+		close(saved_stdout);
+		clearerr(stdout);
+	}
+}
+
+//
+// Run every camera at once on its own thread, requesting
+// captures from the main thread. Returns the number of
+// failed checks.
+//
+int run_cameras()
+{
+	CaptureScheduler scheduler;
+	char filename[STRING_LENGTH];
+	int n, failures = 0;
+	
+	create_processors();
+	for (n=0 ; n<number_cameras ; ++n)
+	{
+		cameras[n].paced = 1;
+		scheduler.addSource(cameras[n].delay, cameras[n].period);
+	}
+	
+	redirect_stdout(RECORDS_FILENAME);
+	unsigned int start_time = (unsigned int)get_time_ms();
+	scheduler.start(start_time);
+	for (n=0 ; n<number_cameras ; ++n) threads[n].start(camera_thread, &cameras[n]);
+	
+	// The RobotEyez message loop
+	while (scheduler.running() > 0)
+	{
+		unsigned int now = (unsigned int)get_time_ms();
+		
+		for (n=0 ; n<number_cameras ; ++n)
+		{
+			if (cameras[n].processor->filesSaved() >= cameras[n].frames) scheduler.finish(n);
+		}
+		
+		while ((n = scheduler.due(now)) >= 0)
+		{
+			sprintf(filename, "cam%d_frame%04d.pgm", n+1, cameras[n].processor->filesSaved() + 1);
+			cameras[n].processor->saveNextFrameToFile(filename);
+		}
+		
+		if (now - start_time > MAX_TEST_MS) break;
+		sleep_ms(scheduler.waitTime(now, 10));
+	}
+	
+	for (n=0 ; n<number_cameras ; ++n) threads[n].join();
+	redirect_stdout(NULL);
+	
+	// Every camera saved its frames at its own size
+	for (n=0 ; n<number_cameras ; ++n)
+	{
+		SyntheticCamera *c = &cameras[n];
+		if (c->processor->filesSaved() != c->frames)
+		{
+			fprintf(stderr, "  camera %d saved %d frames, not %d\n",
+				n+1, c->processor->filesSaved(), c->frames);
+			failures++;
+		}
+		for (int k=1 ; k<=c->processor->filesSaved() ; ++k)
+		{
+			int w = 0, h = 0;
+			sprintf(filename, "cam%d_frame%04d.pgm", n+1, k);
+			FILE *f = fopen(filename, "r");
+			if (f == NULL || fscanf(f, "P2 # Frame captured by RobotEyez %d %d", &w, &h) != 2 ||
+				w != c->width || h != c->height)
+			{
+				fprintf(stderr, "  %s is not a %dx%d frame\n", filename, c->width, c->height);
+				failures++;
+			}
+			if (f) fclose(f);
+			remove(filename);
+		}
+	}
+	
+	delete_processors();
+	return failures;
+}
+
+//
+// Process each camera's frames on their own, one camera
+// after another
+//
+void run_cameras_alone()
+{
+	create_processors();
+	redirect_stdout(SOLO_RECORDS_FILENAME);
+	for (int n=0 ; n<number_cameras ; ++n)
+	{
+		cameras[n].paced = 0;
+		camera_thread(&cameras[n]);
+	}
+	redirect_stdout(NULL);
+	delete_processors();
+}
+
+//
+// Read the next record of a camera and type (e.g. "cam2 " and
+// "features") from a records file, without its latency.
+// Returns 0 at the end of the file.
+//
+int next_record(FILE *f, const char *label, const char *type, char *record, int length)
+{
+	static char line[65536];
+	char name[20];
+	int frame, offset;
+	double latency;
+	
+	while (fgets(line, sizeof(line), f))
+	{
+		if (strncmp(line, label, strlen(label)) != 0) continue;
+		if (sscanf(line + strlen(label), "%19s %d %lf%n", name, &frame, &latency, &offset) != 3) continue;
+		if (strcmp(name, type) != 0) continue;
+		
+		snprintf(record, length, "%d%s", frame, line + strlen(label) + offset);
+		return 1;
+	}
+	return 0;
+}
+
+//
+// Check the records printed with every camera running at
+// once. Returns the number of failed checks.
+//
+int check_records()
+{
+	static char record[65536], solo_record[65536];
+	const char *types[] = {"features", "stats"};
+	char line[65536];
+	int n, t, failures = 0;
+	
+	// Every line starts with a camera's label
+	FILE *f = fopen(RECORDS_FILENAME, "r");
+	if (f == NULL)
+	{
+		fprintf(stderr, "  no records were printed\n");
+		return 1;
+	}
+	int lines = 0;
+	while (fgets(line, sizeof(line), f))
+	{
+		lines++;
+		for (n=0 ; n<number_cameras ; ++n)
+		{
+			if (strncmp(line, cameras[n].label, strlen(cameras[n].label)) == 0) break;
+		}
+		if (n == number_cameras)
+		{
+			fprintf(stderr, "  record without a camera label: %.60s\n", line);
+			failures++;
+		}
+	}
+	fclose(f);
+	printf("%d records printed\n", lines);
+	
+	// Each camera's records are the same as on its own
+	for (n=0 ; n<number_cameras ; ++n)
+	{
+		for (t=0 ; t<2 ; ++t)
+		{
+			FILE *f = fopen(RECORDS_FILENAME, "r");
+			FILE *solo = fopen(SOLO_RECORDS_FILENAME, "r");
+			int count = 0, different = 0;
+			
+			while (next_record(solo, cameras[n].label, types[t], solo_record, sizeof(solo_record)))
+			{
+				count++;
+				if (!next_record(f, cameras[n].label, types[t], record, sizeof(record)) ||
+					strcmp(record, solo_record) != 0) different++;
+			}
+			if (next_record(f, cameras[n].label, types[t], record, sizeof(record))) different++;
+			fclose(f);
+			fclose(solo);
+			
+			if (count != TEST_FRAMES || different > 0)
+			{
+				fprintf(stderr, "  camera %d: %d %s records alone, %d different with every camera running\n",
+					n+1, count, types[t], different);
+				failures++;
+			}
+		}
+	}
+	
+	return failures;
+}
+
+int main()
+{
+	int failures = 0;
+	
+	printf("Multiple camera test\n");
+	failures += run_cameras();
+	run_cameras_alone();
+	failures += check_records();
+	
+	remove(RECORDS_FILENAME);
+	remove(SOLO_RECORDS_FILENAME);
+	
+	if (failures > 0)
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("passed\n");
+	return 0;
+}
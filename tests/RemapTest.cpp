@@ -0,0 +1,164 @@
+//
+// RemapTest.cpp - Accuracy test for FrameRemapper
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Remaps a test frame with several calibrations and compares
+// every output pixel with a double-precision bilinear remap
+// of the same frame through FrameRemapper::sourcePosition.
+// The fixed-point result must be within 1 grey level of the
+// reference everywhere, including the pixels whose 2x2
+// neighbourhood is clamped at the right and bottom edges.
+// Build with -DNO_SSE2 to test the scalar code.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "FrameRemapper.h"
+#include "Platform.h"
+
+#define TEST_WIDTH 640
+#define TEST_HEIGHT 480
+#define MAX_ERROR 1
+
+//
+// Fill a bottom-up BGR frame with smooth shading, a sharp
+// edged grid and a different pattern in each component
+//
+void make_test_frame(unsigned char *pFrame, int w, int h)
+{
+	for (int y=0 ; y<h ; ++y)
+	{
+		unsigned char *p = pFrame + 3*(h-1-y)*w;
+		for (int x=0 ; x<w ; ++x, p+=3)
+		{
+			int grid = ((x / 16) + (y / 16)) % 2;
+			p[0] = (unsigned char)(128 + 120 * sin(x * 0.05) * cos(y * 0.07));
+			p[1] = (unsigned char)(grid ? 200 : 40);
+			p[2] = (unsigned char)((x + 2*y) % 256);
+		}
+	}
+}
+
+//
+// Bilinear interpolation of the bottom-up BGR frame at the
+// top-down position (sx, sy) in double precision
+//
+double reference_value(unsigned char *pFrame, int w, int h, double sx, double sy, int c)
+{
+	int x0 = (int)floor(sx), y0 = (int)floor(sy);
+	int x1 = (x0 + 1 < w) ? x0 + 1 : x0;
+	int y1 = (y0 + 1 < h) ? y0 + 1 : y0;
+	double fx = sx - x0, fy = sy - y0;
+	
+	#define PIXEL(x, y) pFrame[3*((h-1-(y))*w + (x)) + c]
+	return (1-fx)*(1-fy)*PIXEL(x0, y0) + fx*(1-fy)*PIXEL(x1, y0) +
+		(1-fx)*fy*PIXEL(x0, y1) + fx*fy*PIXEL(x1, y1);
+	#undef PIXEL
+}
+
+//
+// Remap the test frame with one calibration and check it
+// against the reference. Returns the number of failures and
+// adds the number of pixels at the clamped edges to *edges.
+//
+int test_calibration(const char *name, CameraCalibration *cal,
+	unsigned char *pSrc, unsigned char *pDest, int *edges)
+{
+	int w = TEST_WIDTH, h = TEST_HEIGHT;
+	int u, v, c, error, max_error = 0, edge_pixels = 0, failures = 0;
+	double sx, sy, total_error = 0;
+	FrameRemapper remapper;
+	
+	remapper.init(cal, w, h);
+	remapper.process(pSrc, pDest);
+	
+	for (v=0 ; v<h ; ++v)
+	{
+		for (u=0 ; u<w ; ++u)
+		{
+			unsigned char *q = pDest + 3*((h-1-v)*w + u);
+			int inside = remapper.sourcePosition(u, v, &sx, &sy);
+			if (inside && (sx > w-2 || sy > h-2)) edge_pixels++;
+			
+			for (c=0 ; c<3 ; ++c)
+			{
+				int expected = inside ? (int)floor(reference_value(pSrc, w, h, sx, sy, c) + 0.5) : 0;
+				error = abs(q[c] - expected);
+				total_error += error;
+				if (error > max_error) max_error = error;
+				if (error > MAX_ERROR && failures++ < 5)
+				{
+					fprintf(stderr, "  %s: pixel (%d,%d) component %d is %d, expected %d\n",
+						name, u, v, c, q[c], expected);
+				}
+			}
+		}
+	}
+	
+	printf("%s: max error %d, mean error %.3f, %d pixels at the clamped edges\n",
+		name, max_error, total_error / (3.0*w*h), edge_pixels);
+	*edges += edge_pixels;
+	
+	return failures;
+}
+
+int main()
+{
+	int w = TEST_WIDTH, h = TEST_HEIGHT;
+	int failures = 0, edges = 0;
+	unsigned char *pSrc = new unsigned char[3*w*h];
+	unsigned char *pDest = new unsigned char[3*w*h];
+	CameraCalibration cal;
+
+#ifdef USE_SSE2
+	printf("FrameRemapper accuracy test (SSE2)\n");
+#else
+	printf("FrameRemapper accuracy test (scalar)\n");
+#endif
+	make_test_frame(pSrc, w, h);
+	
+	// No distortion: every output pixel is its own source,
+	// so the last row and column hit the clamped edges
+	cal.fx = cal.fy = 500;
+	cal.cx = (w - 1) / 2.0;
+	cal.cy = (h - 1) / 2.0;
+	cal.k1 = cal.k2 = cal.p1 = cal.p2 = cal.k3 = 0;
+	cal.use_homography = 0;
+	failures += test_calibration("identity", &cal, pSrc, pDest, &edges);
+	
+	// Barrel distortion with tangential terms
+	cal.k1 = -0.25;
+	cal.k2 = 0.08;
+	cal.p1 = 0.001;
+	cal.p2 = -0.002;
+	failures += test_calibration("barrel", &cal, pSrc, pDest, &edges);
+	
+	// Pincushion distortion
+	cal.k1 = 0.2;
+	cal.k2 = 0;
+	cal.p1 = cal.p2 = 0;
+	failures += test_calibration("pincushion", &cal, pSrc, pDest, &edges);
+	
+	// Homography (scaling down towards the bottom right
+	// corner and a slight perspective) with barrel distortion
+	cal.k1 = -0.1;
+	cal.use_homography = 1;
+	cal.H[0] = 1.02; cal.H[1] = 0.01; cal.H[2] = -3;
+	cal.H[3] = -0.01; cal.H[4] = 1.03; cal.H[5] = -2;
+	cal.H[6] = 0.00002; cal.H[7] = 0.00001; cal.H[8] = 1;
+	failures += test_calibration("homography", &cal, pSrc, pDest, &edges);
+	
+	delete [] pSrc;
+	delete [] pDest;
+	
+	if (failures > 0)
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("passed\n");
+	return 0;
+}
@@ -0,0 +1,222 @@
+//
+// SchedulerTest.cpp - Test of CaptureScheduler with synthetic sources
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Runs the same loop as RobotEyez main() on a simulated clock
+// with several synthetic cameras delivering frames at their
+// own frame rates. A capture request saves the next frame the
+// camera delivers, as FrameProcessor::saveNextFrameToFile
+// does. The loop sleeps for the wait time the scheduler asks
+// for, optionally oversleeping to model a busy message pump,
+// and the request and frame times are checked against the
+// schedule max(last capture + period, start + delay).
+//
+
+#include <stdio.h>
+
+#include "CaptureScheduler.h"
+
+#define MAX_CAPTURES 100
+#define MAX_WAIT 10
+
+// A simulated camera and what was captured from it
+struct SyntheticSource
+{
+	int frame_interval;	// time between delivered frames (ms)
+	int delay, period, frames;	// capture settings as in RobotEyez
+	int pending;	// set while a capture request waits for a frame
+	int saved;	// number of frames saved
+	unsigned int request_times[MAX_CAPTURES];
+	unsigned int frame_times[MAX_CAPTURES];
+};
+
+//
+// Run the capture loop until every source has saved its
+// frames. oversleep is added to every wait. Returns the
+// number of failed checks.
+//
+int run_schedule(const char *name, SyntheticSource *sources, int number_sources,
+	unsigned int start_time, int oversleep)
+{
+	CaptureScheduler scheduler;
+	SyntheticSource *s;
+	unsigned int now = start_time, t;
+	int n, i, failures = 0;
+	
+	for (n=0 ; n<number_sources ; ++n)
+	{
+		s = &sources[n];
+		s->pending = 0;
+		s->saved = 0;
+		scheduler.addSource(s->delay, s->period);
+	}
+	scheduler.start(start_time);
+	
+	while (1)
+	{
+		// Deliver the frame each pending request is waiting for
+		// if it has arrived by now. Frames arrive at multiples
+		// of the source's frame interval after start_time.
+		for (n=0 ; n<number_sources ; ++n)
+		{
+			s = &sources[n];
+			if (!s->pending) continue;
+			t = s->request_times[s->saved];
+			while ((t - start_time) % s->frame_interval != 0) t++;
+			if ((int)(now - t) >= 0)
+			{
+				s->frame_times[s->saved++] = t;
+				s->pending = 0;
+			}
+		}
+		
+		// Finish sources which have saved enough frames
+		for (n=0 ; n<number_sources ; ++n)
+		{
+			if (sources[n].saved >= sources[n].frames) scheduler.finish(n);
+		}
+		
+		// Request captures which are due
+		while ((n = scheduler.due(now)) >= 0)
+		{
+			s = &sources[n];
+			if (s->pending)
+			{
+				// Every source delivers frames more often than it
+				// is captured, so a request is always served first
+				fprintf(stderr, "  %s: source %d still waiting for a frame at %u\n",
+					name, n+1, now - start_time);
+				failures++;
+				continue;
+			}
+			s->request_times[s->saved] = now;
+			s->pending = 1;
+		}
+		
+		if (scheduler.running() == 0) break;
+		if (now - start_time > 100000)
+		{
+			fprintf(stderr, "  %s: schedule did not finish\n", name);
+			return failures + 1;
+		}
+		now += scheduler.waitTime(now, MAX_WAIT) + oversleep;
+	}
+	
+	for (n=0 ; n<number_sources ; ++n)
+	{
+		s = &sources[n];
+		printf("%s: source %d (frame every %d ms, delay %d, period %d):",
+			name, n+1, s->frame_interval, s->delay, s->period);
+		for (i=0 ; i<s->saved ; ++i) printf(" %u", s->frame_times[i] - start_time);
+		printf("\n");
+		
+		for (i=0 ; i<s->saved ; ++i)
+		{
+			// The capture is due period ms after the last one
+			// was requested, but not before the delay
+			unsigned int due = (i == 0) ? start_time + s->period : s->request_times[i-1] + s->period;
+			if ((int)(due - (start_time + s->delay)) < 0) due = start_time + s->delay;
+			
+			// Each request is made when it is due, or at most
+			// one oversleep after
+			int late = (int)(s->request_times[i] - due);
+			if (late < 0 || late > oversleep)
+			{
+				fprintf(stderr, "  %s: source %d capture %d requested at %u, due at %u\n",
+					name, n+1, i+1, s->request_times[i] - start_time, due - start_time);
+				failures++;
+			}
+			
+			// The frame saved is the first one delivered after
+			// the request
+			int wait = (int)(s->frame_times[i] - s->request_times[i]);
+			if (wait < 0 || wait >= s->frame_interval)
+			{
+				fprintf(stderr, "  %s: source %d capture %d saved frame at %u for request at %u\n",
+					name, n+1, i+1, s->frame_times[i] - start_time, s->request_times[i] - start_time);
+				failures++;
+			}
+		}
+		if (s->saved != s->frames)
+		{
+			fprintf(stderr, "  %s: source %d saved %d frames, not %d\n",
+				name, n+1, s->saved, s->frames);
+			failures++;
+		}
+	}
+	
+	return failures;
+}
+
+//
+// Check the exact capture times of the sources in the first
+// test against the values worked out by hand
+//
+int check_exact_times(SyntheticSource *sources)
+{
+	// 30 fps camera captured every 250 ms (the delay is
+	// shorter than the period, so the first is at 250 ms)
+	static unsigned int expected0[] = {264, 528, 759, 1023, 1254};
+	// 25 fps camera captured every frame after 400 ms
+	static unsigned int expected1[] = {400, 440, 480, 520};
+	// 7.5 fps camera captured every 400 ms
+	static unsigned int expected2[] = {532, 931, 1330};
+	unsigned int *expected[] = {expected0, expected1, expected2};
+	int failures = 0;
+	
+	for (int n=0 ; n<3 ; ++n)
+	{
+		for (int i=0 ; i<sources[n].saved && i<sources[n].frames ; ++i)
+		{
+			if (sources[n].frame_times[i] != expected[n][i])
+			{
+				fprintf(stderr, "  exact: source %d frame %d saved at %u, expected %u\n",
+					n+1, i+1, sources[n].frame_times[i], expected[n][i]);
+				failures++;
+			}
+		}
+	}
+	return failures;
+}
+
+int main()
+{
+	int failures = 0;
+	
+	// frame_interval, delay, period, frames, then the
+	// capture state and times which run_schedule fills in
+	SyntheticSource sources[] = {
+		{33, 100, 250, 5, 0, 0, {0}, {0}},
+		{40, 400, 40, 4, 0, 0, {0}, {0}},
+		{133, 50, 400, 3, 0, 0, {0}, {0}},
+	};
+	int number_sources = sizeof(sources) / sizeof(sources[0]);
+	
+	// Captures happen exactly when they are due
+	failures += run_schedule("exact", sources, number_sources, 0, 0);
+	failures += check_exact_times(sources);
+	
+	// The message loop wakes up late, and the clock wraps
+	// around in the middle of the schedule
+	failures += run_schedule("oversleep", sources, number_sources, 0, 7);
+	failures += run_schedule("wrap", sources, number_sources, 0xffffff00u, 3);
+	
+	// More sources, with periods from one frame to a
+	// second, starting at an arbitrary time
+	SyntheticSource fast[] = {
+		{10, 1, 10, 50, 0, 0, {0}, {0}},
+		{16, 1, 16, 30, 0, 0, {0}, {0}},
+		{20, 25, 1000, 2, 0, 0, {0}, {0}},
+		{50, 1000, 100, 3, 0, 0, {0}, {0}},
+	};
+	failures += run_schedule("mixed", fast, sizeof(fast) / sizeof(fast[0]), 12345, 0);
+	
+	if (failures > 0)
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("passed\n");
+	return 0;
+}
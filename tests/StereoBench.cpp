@@ -0,0 +1,196 @@
+//
+// StereoBench.cpp - Benchmark of StereoMatcher on synthetic stereo pairs
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Renders a 640x480 stereo pair of textured rectangles in
+// front of a textured background, each shifted by a known
+// disparity between the left and right images, with a little
+// noise added to both. The pair is matched with 64
+// disparities, and the disparity map is compared with the
+// ground truth of each region. Pixels within a block of a
+// region's edge (where the block straddles two disparities or
+// the right image is occluded) are counted separately. Build
+// with -DNO_SSE2 to measure the scalar code.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "StereoMatcher.h"
+#include "Platform.h"
+
+#define BENCH_WIDTH 640
+#define BENCH_HEIGHT 480
+#define BENCH_DISPARITIES 64
+#define BENCH_FRAMES 50
+
+// A surface parallel to the cameras
+struct Region
+{
+	int x, y, w, h;	// position in the left image
+	int disparity;
+};
+
+// The background first, then rectangles from far to near
+Region regions[] = {
+	{0, 0, BENCH_WIDTH, BENCH_HEIGHT, 4},
+	{80, 60, 200, 150, 16},
+	{350, 80, 220, 160, 32},
+	{120, 280, 180, 150, 48},
+	{400, 300, 180, 140, 62},
+};
+int number_regions = sizeof(regions) / sizeof(regions[0]);
+
+//
+// Pseudo-random texture value of surface s at (u,y)
+//
+int hash(int s, int u, int y)
+{
+	unsigned int h = (unsigned int)(s * 73856093) ^ (unsigned int)(u * 19349663) ^ (unsigned int)(y * 83492791);
+	h ^= h >> 13;
+	h *= 0x5bd1e995;
+	h ^= h >> 15;
+	return h & 0xff;
+}
+
+int texture(int s, int u, int y)
+{
+	// Smooth the noise a little, like a camera's optics
+	return (hash(s, u, y) + hash(s, u+1, y) + hash(s, u, y+1) + hash(s, u+1, y+1)) / 4;
+}
+
+int noise(int x, int y, int image)
+{
+	return hash(100 + image, x, y) % 5 - 2;
+}
+
+//
+// Render the left and right images and the ground truth
+// disparity of each left image pixel. A surface point at
+// left image column x appears at column x - disparity in the
+// right image.
+//
+void render_pair(unsigned char *pLeft, unsigned char *pRight, unsigned char *truth)
+{
+	int w = BENCH_WIDTH;
+	int x, y, s, v;
+	
+	for (s=0 ; s<number_regions ; ++s)
+	{
+		Region *r = &regions[s];
+		for (y=r->y ; y<r->y+r->h ; ++y)
+		{
+			for (x=r->x ; x<r->x+r->w ; ++x)
+			{
+				v = texture(s, x, y) + noise(x, y, 0);
+				pLeft[y*w + x] = (unsigned char)(v < 0 ? 0 : v > 255 ? 255 : v);
+				truth[y*w + x] = (unsigned char)r->disparity;
+			}
+			for (x=r->x-r->disparity ; x<r->x+r->w-r->disparity ; ++x)
+			{
+				if (x < 0 || x >= w) continue;
+				
+				// The background shows beyond the left edge of
+				// the left image too
+				v = texture(s, x + r->disparity, y) + noise(x, y, 1);
+				pRight[y*w + x] = (unsigned char)(v < 0 ? 0 : v > 255 ? 255 : v);
+			}
+		}
+	}
+}
+
+//
+// Returns non-zero if the block around (x,y) lies in one
+// region of the left image and is visible in the right
+//
+int interior_pixel(unsigned char *truth, int x, int y)
+{
+	int R = STEREO_BLOCK_SIZE / 2;
+	int w = BENCH_WIDTH;
+	int d = truth[y*w + x];
+	
+	for (int j=y-R ; j<=y+R ; ++j)
+	{
+		for (int i=x-R ; i<=x+R ; ++i)
+		{
+			if (truth[j*w + i] != d) return 0;
+			
+			// Occluded in the right image by a nearer region
+			for (int s=0 ; s<number_regions ; ++s)
+			{
+				Region *r = &regions[s];
+				if (r->disparity > d && j >= r->y && j < r->y + r->h &&
+					i - d >= r->x - r->disparity && i - d < r->x + r->w - r->disparity) return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+int main()
+{
+	int w = BENCH_WIDTH, h = BENCH_HEIGHT;
+	int R = STEREO_BLOCK_SIZE / 2;
+	int x_start = BENCH_DISPARITIES - 1 + R;
+	int x, y, n, error;
+	unsigned char *pLeft = new unsigned char[w*h];
+	unsigned char *pRight = new unsigned char[w*h];
+	unsigned char *truth = new unsigned char[w*h];
+	unsigned char *disparity = new unsigned char[w*h];
+	StereoMatcher matcher;
+
+#ifdef USE_SSE2
+	printf("StereoMatcher benchmark (SSE2)\n");
+#else
+	printf("StereoMatcher benchmark (scalar)\n");
+#endif
+	render_pair(pLeft, pRight, truth);
+	if (matcher.init(w, h, BENCH_DISPARITIES) != 0)
+	{
+		fprintf(stderr, "Could not initialise the matcher\n");
+		return 1;
+	}
+	
+	// Time the matching
+	matcher.compute(pLeft, pRight, disparity);
+	double start_time = get_time_ms();
+	for (n=0 ; n<BENCH_FRAMES ; ++n) matcher.compute(pLeft, pRight, disparity);
+	double frame_time = (get_time_ms() - start_time) / BENCH_FRAMES;
+	
+	// Compare with the ground truth in each region. Pixels
+	// without a full search range or block have no disparity.
+	int count[2] = {0, 0}, correct[2] = {0, 0}, bad[2] = {0, 0};
+	double total_error[2] = {0, 0};
+	for (y=R ; y<h-R ; ++y)
+	{
+		for (x=x_start ; x<w-R ; ++x)
+		{
+			int interior = interior_pixel(truth, x, y);
+			error = abs(disparity[y*w + x] - truth[y*w + x]);
+			count[interior]++;
+			total_error[interior] += error;
+			if (error == 0) correct[interior]++;
+			if (error > 1) bad[interior]++;
+		}
+	}
+	
+	printf("%dx%d, %d disparities, %dx%d blocks: %.2f ms/frame (%.1f frames/s)\n",
+		w, h, BENCH_DISPARITIES, STEREO_BLOCK_SIZE, STEREO_BLOCK_SIZE,
+		frame_time, 1000.0 / frame_time);
+	const char *names[2] = {"near region edges", "inside regions"};
+	for (n=1 ; n>=0 ; --n)
+	{
+		if (count[n] == 0) continue;
+		printf("%s: %d pixels, mean error %.3f, %.1f%% exact, %.1f%% wrong by more than 1\n",
+			names[n], count[n], total_error[n] / count[n],
+			100.0 * correct[n] / count[n], 100.0 * bad[n] / count[n]);
+	}
+	
+	delete [] pLeft;
+	delete [] pRight;
+	delete [] truth;
+	delete [] disparity;
+	return 0;
+}
@@ -0,0 +1,178 @@
+//
+// TrackerTest.cpp - Test of FeatureTracker on a moving synthetic image
+//
+// Website: http://batchloaf.wordpress.com
+//
+// Renders a 640x480 textured image moving by a known
+// sub-pixel amount each frame and checks that the features
+// tracked from one frame to the next moved by that amount,
+// that the tracker keeps close to its maximum number of
+// features and that they are spread over the whole image.
+// The time per frame is printed for comparing the SSE2 and
+// scalar (-DNO_SSE2) builds.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "FeatureTracker.h"
+#include "Platform.h"
+
+#define TEST_WIDTH 640
+#define TEST_HEIGHT 480
+#define TEST_FRAMES 60
+#define TEST_FEATURES 500
+
+// Motion of the image each frame (pixels)
+#define MOTION_X 1.3
+#define MOTION_Y -0.7
+
+// Tracked positions must be this close to the true motion
+#define MAX_POSITION_ERROR 0.1
+
+// After the first frame every frame must hold at least this
+// many features, with at least MIN_QUADRANT_FEATURES in each
+// quarter of the image
+#define MIN_FEATURES (TEST_FEATURES * 95 / 100)
+#define MIN_QUADRANT_FEATURES (TEST_FEATURES / 5)
+
+// Texture: random grey levels on a coarse grid, bilinearly
+// interpolated so that it can be shifted by any amount
+#define GRID_SPACING 4
+#define GRID_WIDTH (TEST_WIDTH / GRID_SPACING + 64)
+#define GRID_HEIGHT (TEST_HEIGHT / GRID_SPACING + 64)
+
+unsigned char grid[GRID_WIDTH * GRID_HEIGHT];
+
+//
+// Render the texture with its origin moved to (ox, oy)
+//
+void render(unsigned char *pGrey, double ox, double oy)
+{
+	for (int y=0 ; y<TEST_HEIGHT ; ++y)
+	{
+		for (int x=0 ; x<TEST_WIDTH ; ++x)
+		{
+			double u = (x - ox) / GRID_SPACING + 32, v = (y - oy) / GRID_SPACING + 32;
+			int i = (int)floor(u), j = (int)floor(v);
+			double fx = u - i, fy = v - j;
+			unsigned char *g = grid + j*GRID_WIDTH + i;
+			pGrey[y*TEST_WIDTH + x] = (unsigned char)((1-fx)*(1-fy)*g[0] + fx*(1-fy)*g[1] +
+				(1-fx)*fy*g[GRID_WIDTH] + fx*fy*g[GRID_WIDTH+1] + 0.5);
+		}
+	}
+}
+
+int main()
+{
+	int n, k, frame, failures = 0;
+	int possible = 0, tracked = 0, wrong = 0;
+	int fewest = TEST_FEATURES, fewest_quadrant = TEST_FEATURES;
+	double first_time = 0, total_time = 0, max_error = 0;
+	unsigned char *pGrey = new unsigned char[TEST_WIDTH * TEST_HEIGHT];
+	Feature *previous = new Feature[TEST_FEATURES];
+	int number_previous = 0;
+	FeatureTracker tracker;
+
+#ifdef USE_SSE2
+	printf("FeatureTracker test (SSE2)\n");
+#else
+	printf("FeatureTracker test (scalar)\n");
+#endif
+	srand(1);
+	for (n=0 ; n<GRID_WIDTH * GRID_HEIGHT ; ++n) grid[n] = (unsigned char)(rand() % 256);
+	tracker.init(TEST_WIDTH, TEST_HEIGHT, TEST_FEATURES);
+	
+	for (frame=0 ; frame<TEST_FRAMES ; ++frame)
+	{
+		render(pGrey, frame * MOTION_X, frame * MOTION_Y);
+		
+		// The first frame is searched for corners everywhere,
+		// so it is timed separately
+		double start_time = get_time_ms();
+		int number_features = tracker.process(pGrey);
+		if (frame == 0) first_time = get_time_ms() - start_time;
+		else total_time += get_time_ms() - start_time;
+		
+		// Features with the same id as in the last frame
+		// should have moved with the image
+		Feature *features = tracker.features();
+		possible += number_previous;
+		for (n=0, k=0 ; n<number_features ; ++n)
+		{
+			while (k < number_previous && previous[k].id < features[n].id) k++;
+			if (k == number_previous || previous[k].id != features[n].id) continue;
+			
+			double error = sqrt(pow(features[n].x - previous[k].x - MOTION_X, 2) +
+				pow(features[n].y - previous[k].y - MOTION_Y, 2));
+			tracked++;
+			if (error > max_error) max_error = error;
+			if (error > MAX_POSITION_ERROR) wrong++;
+		}
+		
+		// Count the features in each quarter of the image
+		int quadrants[4] = {0, 0, 0, 0};
+		for (n=0 ; n<number_features ; ++n)
+		{
+			quadrants[(features[n].x >= TEST_WIDTH/2) + 2*(features[n].y >= TEST_HEIGHT/2)]++;
+		}
+		if (frame > 0)
+		{
+			if (number_features < fewest) fewest = number_features;
+			for (n=0 ; n<4 ; ++n)
+			{
+				if (quadrants[n] < fewest_quadrant) fewest_quadrant = quadrants[n];
+			}
+		}
+		
+		for (n=0 ; n<number_features ; ++n) previous[n] = features[n];
+		number_previous = number_features;
+	}
+	
+	printf("%dx%d, up to %d features: first frame %.2f ms, then %.2f ms/frame\n",
+		TEST_WIDTH, TEST_HEIGHT, TEST_FEATURES, first_time, total_time / (TEST_FRAMES - 1));
+	printf("at least %d features per frame, at least %d in each quarter of the image\n",
+		fewest, fewest_quadrant);
+	printf("%d of %d features tracked to the next frame, max error %.3f pixels, %d wrong\n",
+		tracked, possible, max_error, wrong);
+	
+	// The tracker stays close to its maximum number of
+	// features, spread over the whole image
+	if (fewest < MIN_FEATURES)
+	{
+		fprintf(stderr, "  only %d features in a frame, expected at least %d\n",
+			fewest, MIN_FEATURES);
+		failures++;
+	}
+	if (fewest_quadrant < MIN_QUADRANT_FEATURES)
+	{
+		fprintf(stderr, "  only %d features in a quarter of the image, expected at least %d\n",
+			fewest_quadrant, MIN_QUADRANT_FEATURES);
+		failures++;
+	}
+	
+	// Few features should be lost, other than at the edges
+	if (tracked < possible * 95 / 100)
+	{
+		fprintf(stderr, "  only %d of %d features were tracked\n", tracked, possible);
+		failures++;
+	}
+	if (wrong > tracked / 100)
+	{
+		fprintf(stderr, "  %d features moved by more than %.2f pixels from the true motion\n",
+			wrong, MAX_POSITION_ERROR);
+		failures++;
+	}
+	
+	delete [] pGrey;
+	delete [] previous;
+	
+	if (failures > 0)
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("passed\n");
+	return 0;
+}